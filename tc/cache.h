@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cache {
+
+  /// Bounded least-recently-used cache split into shards with a mutex each, so
+  /// lookups of different keys rarely wait for each other. Values are returned
+  /// by copy; keep them cheap to copy (e.g. std::shared_ptr<const T>).
+  /// Capacity 0 disables the cache: nothing is stored, every lookup misses.
+  template <typename Key, typename Value, typename Hash = std::hash<Key>>
+  class ShardedLruCache {
+  public:
+	static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+
+	explicit ShardedLruCache(size_t capacity = 0, size_t shard_count = DEFAULT_SHARD_COUNT)
+		: shards_(std::max<size_t>(shard_count, 1)) {
+	  SetCapacity(capacity);
+	}
+
+	/// Drops the stored values when the capacity shrinks.
+	void SetCapacity(size_t capacity) {
+	  const size_t shard_capacity = (capacity + shards_.size() - 1) / shards_.size();
+	  for (Shard& shard : shards_) {
+		std::lock_guard lock(shard.mutex);
+		shard.capacity = shard_capacity;
+		while (shard.values.size() > shard.capacity) {
+		  shard.index.erase(shard.values.back().first);
+		  shard.values.pop_back();
+		}
+	  }
+	}
+
+	std::optional<Value> Find(const Key& key) {
+	  Shard& shard = GetShard(key);
+	  std::lock_guard lock(shard.mutex);
+	  const auto it = shard.index.find(key);
+	  if (it == shard.index.end()) {
+		++miss_count_;
+		return std::nullopt;
+	  }
+	  ++hit_count_;
+	  shard.values.splice(shard.values.begin(), shard.values, it->second);
+	  return it->second->second;
+	}
+
+	/// Stores the value as the most recently used one, evicting the least
+	/// recently used value of the shard when it is full.
+	void Insert(const Key& key, Value value) {
+	  Shard& shard = GetShard(key);
+	  std::lock_guard lock(shard.mutex);
+	  if (shard.capacity == 0) {
+		return;
+	  }
+	  if (const auto it = shard.index.find(key); it != shard.index.end()) {
+		it->second->second = std::move(value);
+		shard.values.splice(shard.values.begin(), shard.values, it->second);
+		return;
+	  }
+	  if (shard.values.size() == shard.capacity) {
+		shard.index.erase(shard.values.back().first);
+		shard.values.pop_back();
+	  }
+	  shard.values.emplace_front(key, std::move(value));
+	  shard.index.emplace(key, shard.values.begin());
+	}
+
+	/// Drops all values, the counters are kept.
+	void Clear() {
+	  for (Shard& shard : shards_) {
+		std::lock_guard lock(shard.mutex);
+		shard.values.clear();
+		shard.index.clear();
+	  }
+	}
+
+	size_t GetSize() const {
+	  size_t size = 0;
+	  for (const Shard& shard : shards_) {
+		std::lock_guard lock(shard.mutex);
+		size += shard.values.size();
+	  }
+	  return size;
+	}
+
+	size_t GetHitCount() const {
+	  return hit_count_;
+	}
+
+	size_t GetMissCount() const {
+	  return miss_count_;
+	}
+
+  private:
+	using Values = std::list<std::pair<Key, Value>>;
+
+	struct Shard {
+	  mutable std::mutex mutex;
+	  size_t capacity = 0;
+	  Values values;	 /// most recently used first
+	  std::unordered_map<Key, typename Values::iterator, Hash> index;
+	};
+
+	Shard& GetShard(const Key& key) {
+	  /// the high bits of a Fibonacci hash, weak hashes still spread over shards
+	  const uint64_t hash = static_cast<uint64_t>(Hash {}(key)) * 0x9E3779B97F4A7C15ull;
+	  return shards_[(hash >> 32) % shards_.size()];
+	}
+
+	std::vector<Shard> shards_;
+	std::atomic<size_t> hit_count_ {0};
+	std::atomic<size_t> miss_count_ {0};
+  };
+
+}  // namespace cache
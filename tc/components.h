@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+namespace graph {
+
+  /// Reachability metadata of a frozen DirectedWeightedGraph, O(V) memory.
+  /// Strongly connected components are numbered in reverse topological order
+  /// (Tarjan): an edge between two components goes to the lesser id, so a route
+  /// from u to v needs component(u) >= component(v). Weakly connected
+  /// subnetworks tell apart the pairs the order alone doesn't.
+  class Components {
+  public:
+	struct ComponentData {
+	  std::vector<uint32_t> components;	  /// strongly connected, of every vertex
+	  std::vector<uint32_t> subnetworks;  /// weakly connected, of every vertex
+	};
+
+	Components() = default;
+	template <typename Weight>
+	explicit Components(const DirectedWeightedGraph<Weight>& graph);
+
+	/// False only if there is no route from the vertex to the other; always
+	/// true for the vertices out of the data.
+	bool MayReach(VertexId from, VertexId to) const {
+	  if (from >= data_.components.size() || to >= data_.components.size()) {
+		return true;
+	  }
+	  return data_.subnetworks[from] == data_.subnetworks[to]
+			 && data_.components[from] >= data_.components[to];
+	}
+
+	ComponentData& ModifyComponentData() {
+	  return data_;
+	}
+
+	const ComponentData& GetComponentData() const {
+	  return data_;
+	}
+
+  private:
+	template <typename Weight>
+	void FindComponents(const DirectedWeightedGraph<Weight>& graph);
+	template <typename Weight>
+	void FindSubnetworks(const DirectedWeightedGraph<Weight>& graph);
+
+	static constexpr uint32_t NO_ID = std::numeric_limits<uint32_t>::max();
+
+	ComponentData data_;
+  };
+
+  template <typename Weight>
+  Components::Components(const DirectedWeightedGraph<Weight>& graph) {
+	FindComponents(graph);
+	FindSubnetworks(graph);
+  }
+
+  /// Tarjan's algorithm with an explicit stack, the next edge of every vertex
+  /// on it is kept to resume the scan.
+  template <typename Weight>
+  void Components::FindComponents(const DirectedWeightedGraph<Weight>& graph) {
+	const size_t vertex_count = graph.GetVertexCount();
+	data_.components.assign(vertex_count, NO_ID);
+	std::vector<uint32_t> indexes(vertex_count, NO_ID);
+	std::vector<uint32_t> low_links(vertex_count, 0);
+	std::vector<VertexId> component_stack;
+	std::vector<std::pair<VertexId, EdgeId>> search_stack;
+	uint32_t index = 0;
+	uint32_t component = 0;
+
+	auto visit = [&](VertexId vertex) {
+	  indexes[vertex] = low_links[vertex] = index++;
+	  component_stack.push_back(vertex);
+	  search_stack.emplace_back(vertex, *graph.GetIncidentEdges(vertex).begin());
+	};
+	for (VertexId root = 0; root < vertex_count; ++root) {
+	  if (indexes[root] != NO_ID) {
+		continue;
+	  }
+	  visit(root);
+	  while (!search_stack.empty()) {
+		auto& [vertex, next_edge] = search_stack.back();
+		if (next_edge != *graph.GetIncidentEdges(vertex).end()) {
+		  const VertexId to = graph.GetEdge(next_edge++).to;
+		  if (indexes[to] == NO_ID) {
+			visit(to);
+		  } else if (data_.components[to] == NO_ID) {
+			low_links[vertex] = std::min(low_links[vertex], indexes[to]);
+		  }
+		  continue;
+		}
+		const VertexId done = vertex;
+		search_stack.pop_back();
+		if (!search_stack.empty()) {
+		  const VertexId parent = search_stack.back().first;
+		  low_links[parent] = std::min(low_links[parent], low_links[done]);
+		}
+		if (low_links[done] == indexes[done]) {
+		  VertexId member;
+		  do {
+			member = component_stack.back();
+			component_stack.pop_back();
+			data_.components[member] = component;
+		  } while (member != done);
+		  ++component;
+		}
+	  }
+	}
+  }
+
+  /// Union-find over the edges, the subnetworks numbered by their least vertex.
+  template <typename Weight>
+  void Components::FindSubnetworks(const DirectedWeightedGraph<Weight>& graph) {
+	const size_t vertex_count = graph.GetVertexCount();
+	std::vector<VertexId> parents(vertex_count);
+	std::iota(parents.begin(), parents.end(), VertexId {0});
+	auto find = [&parents](VertexId vertex) {
+	  while (parents[vertex] != vertex) {
+		vertex = parents[vertex] = parents[parents[vertex]];
+	  }
+	  return vertex;
+	};
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+	  const auto& edge = graph.GetEdge(edge_id);
+	  const VertexId from = find(edge.from);
+	  const VertexId to = find(edge.to);
+	  if (from != to) {
+		parents[std::max(from, to)] = std::min(from, to);
+	  }
+	}
+	data_.subnetworks.assign(vertex_count, NO_ID);
+	uint32_t subnetwork = 0;
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+	  const VertexId root = find(vertex);
+	  if (data_.subnetworks[root] == NO_ID) {
+		data_.subnetworks[root] = subnetwork++;
+	  }
+	  data_.subnetworks[vertex] = data_.subnetworks[root];
+	}
+  }
+
+}  // namespace graph
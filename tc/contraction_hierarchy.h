@@ -0,0 +1,498 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "router.h"
+#include "search_space.h"
+
+namespace graph {
+
+  /// Contraction hierarchy over a DirectedWeightedGraph. Vertices are contracted
+  /// one by one in order of importance, shortcuts preserve shortest paths between
+  /// the remaining ones. Queries run a bidirectional search that only climbs the
+  /// hierarchy; shortcuts are unpacked back to the original graph edges.
+  template <typename Weight>
+  class ContractionHierarchy {
+  private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+  public:
+	explicit ContractionHierarchy(const Graph& graph);
+
+	using RouteInfo = typename Router<Weight>::RouteInfo;
+
+	static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+	/// Either an original graph edge or a shortcut of two hierarchy edges.
+	struct HierarchyEdge {
+	  VertexId from;
+	  VertexId to;
+	  Weight weight;
+	  EdgeId original_edge = NO_EDGE;
+	  EdgeId first_child = NO_EDGE;
+	  EdgeId second_child = NO_EDGE;
+	};
+
+	struct HierarchyData {
+	  std::vector<HierarchyEdge> edges;
+	  std::vector<IncidenceList> upward;	 /// by source, target is ranked higher
+	  std::vector<IncidenceList> downward;	 /// by target, source is ranked higher
+	};
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	/// Bucket-based many-to-many: the upward search spaces of the targets are
+	/// put in buckets of their vertices, then one upward search per source scans
+	/// the buckets. Row-major by source, std::nullopt where there is no route.
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+													const std::vector<VertexId>& targets) const;
+
+	HierarchyData& ModifyHierarchyData() {
+	  return data_;
+	}
+
+	const HierarchyData& GetHierarchyData() const {
+	  return data_;
+	}
+
+  private:
+	using SearchSpace = graph::SearchSpace<Weight, EdgeId>;
+	using QueueItem = typename SearchSpace::QueueItem;
+
+	struct WorkingArc {
+	  VertexId vertex;
+	  EdgeId edge;
+	};
+
+	/// Remaining (not yet contracted) part of the graph during preprocessing.
+	struct ContractionState {
+	  std::vector<std::vector<WorkingArc>> out;
+	  std::vector<std::vector<WorkingArc>> in;
+	  std::vector<int64_t> contracted_neighbors;
+	  SearchSpace witness;
+	};
+
+	void AddWorkingEdge(ContractionState& state, const HierarchyEdge& edge);
+	void RunWitnessSearch(ContractionState& state, VertexId source, VertexId excluded,
+						  Weight max_weight, bool is_forward) const;
+	/// Returns the number of shortcuts, adds them only when add_shortcuts is set.
+	int64_t ContractVertex(ContractionState& state, VertexId vertex, bool add_shortcuts);
+	int64_t ComputePriority(ContractionState& state, VertexId vertex);
+	void FinishVertex(ContractionState& state, VertexId vertex);
+	void CompactEdges();
+	void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+	/// Exhausts the search that only climbs the hierarchy, calls
+	/// visit(vertex, weight) for every settled vertex.
+	template <typename Visit>
+	void RunUpwardSearch(SearchSpace& space, VertexId from, bool is_forward,
+						 const Visit& visit) const;
+
+	static constexpr Weight ZERO_WEIGHT {};
+	static constexpr size_t WITNESS_SETTLE_LIMIT = 100;
+
+	HierarchyData data_;
+	mutable SearchSpace forward_;
+	mutable SearchSpace backward_;
+  };
+
+  template <typename Weight>
+  ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph) {
+	const size_t vertex_count = graph.GetVertexCount();
+	data_.upward.resize(vertex_count);
+	data_.downward.resize(vertex_count);
+
+	ContractionState state;
+	state.out.resize(vertex_count);
+	state.in.resize(vertex_count);
+	state.contracted_neighbors.assign(vertex_count, 0);
+	state.witness.Prepare(vertex_count);
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+	  const auto& edge = graph.GetEdge(edge_id);
+	  if (edge.weight < ZERO_WEIGHT) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	  if (edge.from != edge.to) {
+		AddWorkingEdge(state, {edge.from, edge.to, edge.weight, edge_id});
+	  }
+	}
+
+	using PriorityItem = std::pair<int64_t, VertexId>;
+	std::vector<PriorityItem> queue;
+	queue.reserve(vertex_count);
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+	  queue.emplace_back(ComputePriority(state, vertex), vertex);
+	}
+	std::make_heap(queue.begin(), queue.end(), std::greater<PriorityItem> {});
+
+	while (!queue.empty()) {
+	  std::pop_heap(queue.begin(), queue.end(), std::greater<PriorityItem> {});
+	  const VertexId vertex = queue.back().second;
+	  queue.pop_back();
+	  const int64_t priority = ComputePriority(state, vertex);
+	  if (!queue.empty() && priority > queue.front().first) {
+		queue.emplace_back(priority, vertex);
+		std::push_heap(queue.begin(), queue.end(), std::greater<PriorityItem> {});
+		continue;
+	  }
+	  ContractVertex(state, vertex, true);
+	  FinishVertex(state, vertex);
+	}
+	CompactEdges();
+  }
+
+  template <typename Weight>
+  void ContractionHierarchy<Weight>::AddWorkingEdge(ContractionState& state,
+													const HierarchyEdge& edge) {
+	auto& out_arcs = state.out[edge.from];
+	auto it = std::find_if(out_arcs.begin(), out_arcs.end(),
+						   [&edge](const WorkingArc& arc) { return arc.vertex == edge.to; });
+	if (it != out_arcs.end() && !(edge.weight < data_.edges[it->edge].weight)) {
+	  return;
+	}
+	const EdgeId edge_id = data_.edges.size();
+	data_.edges.push_back(edge);
+	if (it != out_arcs.end()) {
+	  it->edge = edge_id;
+	  for (auto& arc : state.in[edge.to]) {
+		if (arc.vertex == edge.from) {
+		  arc.edge = edge_id;
+		}
+	  }
+	} else {
+	  out_arcs.push_back({edge.to, edge_id});
+	  state.in[edge.to].push_back({edge.from, edge_id});
+	}
+  }
+
+  template <typename Weight>
+  void ContractionHierarchy<Weight>::RunWitnessSearch(ContractionState& state,
+													  VertexId source, VertexId excluded,
+													  Weight max_weight,
+													  bool is_forward) const {
+	SearchSpace& witness = state.witness;
+	witness.Reset();
+	witness.Reach(source, ZERO_WEIGHT, NO_EDGE);
+	size_t settled = 0;
+	while (!witness.heap.empty() && settled < WITNESS_SETTLE_LIMIT) {
+	  const QueueItem item = witness.Pop();
+	  if (item.weight > witness.weights[item.vertex]) {
+		continue;
+	  }
+	  if (item.weight > max_weight) {
+		break;
+	  }
+	  ++settled;
+	  const auto& arcs = is_forward ? state.out[item.vertex] : state.in[item.vertex];
+	  for (const WorkingArc& arc : arcs) {
+		if (arc.vertex == excluded) {
+		  continue;
+		}
+		const Weight candidate_weight = item.weight + data_.edges[arc.edge].weight;
+		if (witness.IsImprovedBy(arc.vertex, candidate_weight)) {
+		  witness.Reach(arc.vertex, candidate_weight, arc.edge);
+		}
+	  }
+	}
+  }
+
+  template <typename Weight>
+  int64_t ContractionHierarchy<Weight>::ContractVertex(ContractionState& state,
+													   VertexId vertex,
+													   bool add_shortcuts) {
+	int64_t shortcut_count = 0;
+	std::vector<HierarchyEdge> shortcuts;
+	/// Witness searches start from the side of the vertex with fewer arcs, so
+	/// there are fewer of them; in the two vertex per stop model that is the
+	/// single WAIT edge of an IN or OUT vertex.
+	const bool is_forward = state.in[vertex].size() <= state.out[vertex].size();
+	const auto& sources = is_forward ? state.in[vertex] : state.out[vertex];
+	const auto& targets = is_forward ? state.out[vertex] : state.in[vertex];
+	for (const WorkingArc& source_arc : sources) {
+	  const Weight source_weight = data_.edges[source_arc.edge].weight;
+	  Weight max_weight = ZERO_WEIGHT;
+	  for (const WorkingArc& target_arc : targets) {
+		if (target_arc.vertex != source_arc.vertex) {
+		  max_weight
+			  = std::max(max_weight, source_weight + data_.edges[target_arc.edge].weight);
+		}
+	  }
+	  RunWitnessSearch(state, source_arc.vertex, vertex, max_weight, is_forward);
+	  for (const WorkingArc& target_arc : targets) {
+		if (target_arc.vertex == source_arc.vertex) {
+		  continue;
+		}
+		const Weight shortcut_weight = source_weight + data_.edges[target_arc.edge].weight;
+		if (state.witness.reached[target_arc.vertex]
+			&& !(shortcut_weight < state.witness.weights[target_arc.vertex])) {
+		  continue;
+		}
+		++shortcut_count;
+		if (add_shortcuts) {
+		  const WorkingArc& in_arc = is_forward ? source_arc : target_arc;
+		  const WorkingArc& out_arc = is_forward ? target_arc : source_arc;
+		  shortcuts.push_back({in_arc.vertex, out_arc.vertex, shortcut_weight, NO_EDGE,
+							   in_arc.edge, out_arc.edge});
+		}
+	  }
+	}
+	for (const HierarchyEdge& shortcut : shortcuts) {
+	  AddWorkingEdge(state, shortcut);
+	}
+	return shortcut_count;
+  }
+
+  template <typename Weight>
+  int64_t ContractionHierarchy<Weight>::ComputePriority(ContractionState& state,
+														VertexId vertex) {
+	const int64_t removed_count
+		= static_cast<int64_t>(state.in[vertex].size() + state.out[vertex].size());
+	return ContractVertex(state, vertex, false) - removed_count
+		   + state.contracted_neighbors[vertex];
+  }
+
+  template <typename Weight>
+  void ContractionHierarchy<Weight>::FinishVertex(ContractionState& state,
+												  VertexId vertex) {
+	for (const WorkingArc& in_arc : state.in[vertex]) {
+	  data_.downward[vertex].push_back(in_arc.edge);
+	  auto& out_arcs = state.out[in_arc.vertex];
+	  out_arcs.erase(std::remove_if(out_arcs.begin(), out_arcs.end(),
+									[vertex](const WorkingArc& arc) {
+									  return arc.vertex == vertex;
+									}),
+					 out_arcs.end());
+	  ++state.contracted_neighbors[in_arc.vertex];
+	}
+	for (const WorkingArc& out_arc : state.out[vertex]) {
+	  data_.upward[vertex].push_back(out_arc.edge);
+	  auto& in_arcs = state.in[out_arc.vertex];
+	  in_arcs.erase(std::remove_if(in_arcs.begin(), in_arcs.end(),
+								   [vertex](const WorkingArc& arc) {
+									 return arc.vertex == vertex;
+								   }),
+					in_arcs.end());
+	  ++state.contracted_neighbors[out_arc.vertex];
+	}
+	state.in[vertex].clear();
+	state.in[vertex].shrink_to_fit();
+	state.out[vertex].clear();
+	state.out[vertex].shrink_to_fit();
+  }
+
+  /// Drops edges that were superseded during contraction and renumbers the rest.
+  template <typename Weight>
+  void ContractionHierarchy<Weight>::CompactEdges() {
+	std::vector<EdgeId> new_ids(data_.edges.size(), NO_EDGE);
+	std::vector<HierarchyEdge> edges;
+	auto keep = [this, &new_ids, &edges](EdgeId edge_id) {
+	  if (new_ids[edge_id] == NO_EDGE) {
+		new_ids[edge_id] = edges.size();
+		edges.push_back(data_.edges[edge_id]);
+	  }
+	};
+	for (const auto& list : data_.upward) {
+	  std::for_each(list.begin(), list.end(), keep);
+	}
+	for (const auto& list : data_.downward) {
+	  std::for_each(list.begin(), list.end(), keep);
+	}
+	for (auto& edge : edges) {
+	  if (edge.original_edge == NO_EDGE) {
+		edge.first_child = new_ids[edge.first_child];
+		edge.second_child = new_ids[edge.second_child];
+	  }
+	}
+	for (auto* lists : {&data_.upward, &data_.downward}) {
+	  for (auto& list : *lists) {
+		for (EdgeId& edge_id : list) {
+		  edge_id = new_ids[edge_id];
+		}
+	  }
+	}
+	data_.edges = std::move(edges);
+  }
+
+  template <typename Weight>
+  void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id,
+												std::vector<EdgeId>& edges) const {
+	std::vector<EdgeId> stack {edge_id};
+	while (!stack.empty()) {
+	  const HierarchyEdge& edge = data_.edges[stack.back()];
+	  stack.pop_back();
+	  if (edge.original_edge != NO_EDGE) {
+		edges.push_back(edge.original_edge);
+	  } else {
+		stack.push_back(edge.second_child);
+		stack.push_back(edge.first_child);
+	  }
+	}
+  }
+
+  template <typename Weight>
+  std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+  ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+	const size_t vertex_count = data_.upward.size();
+	if (from >= vertex_count || to >= vertex_count) {
+	  throw std::out_of_range("Vertex is out of graph");
+	}
+	forward_.Prepare(vertex_count);
+	backward_.Prepare(vertex_count);
+	forward_.Reach(from, ZERO_WEIGHT, NO_EDGE);
+	backward_.Reach(to, ZERO_WEIGHT, NO_EDGE);
+
+	std::optional<Weight> best_weight;
+	VertexId meeting_vertex = from;
+	auto step = [this, &best_weight, &meeting_vertex](SearchSpace& space,
+													  const SearchSpace& other,
+													  bool is_forward) {
+	  const QueueItem item = space.Pop();
+	  if (item.weight > space.weights[item.vertex]) {
+		return;
+	  }
+	  if (best_weight && !(item.weight < *best_weight)) {
+		space.heap.clear();
+		return;
+	  }
+	  if (other.reached[item.vertex]) {
+		const Weight candidate_weight = item.weight + other.weights[item.vertex];
+		if (!best_weight || candidate_weight < *best_weight) {
+		  best_weight = candidate_weight;
+		  meeting_vertex = item.vertex;
+		}
+	  }
+	  const auto& lists = is_forward ? data_.upward : data_.downward;
+	  for (const EdgeId edge_id : lists[item.vertex]) {
+		const HierarchyEdge& edge = data_.edges[edge_id];
+		const VertexId next = is_forward ? edge.to : edge.from;
+		const Weight candidate_weight = item.weight + edge.weight;
+		if (space.IsImprovedBy(next, candidate_weight)) {
+		  space.Reach(next, candidate_weight, edge_id);
+		}
+	  }
+	};
+	while (!forward_.heap.empty() || !backward_.heap.empty()) {
+	  if (!forward_.heap.empty()) {
+		step(forward_, backward_, true);
+	  }
+	  if (!backward_.heap.empty()) {
+		step(backward_, forward_, false);
+	  }
+	}
+
+	if (!best_weight) {
+	  forward_.Reset();
+	  backward_.Reset();
+	  return std::nullopt;
+	}
+	std::vector<EdgeId> hierarchy_edges;
+	for (EdgeId edge_id = forward_.prevs[meeting_vertex]; edge_id != NO_EDGE;
+		 edge_id = forward_.prevs[data_.edges[edge_id].from]) {
+	  hierarchy_edges.push_back(edge_id);
+	}
+	std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+	for (EdgeId edge_id = backward_.prevs[meeting_vertex]; edge_id != NO_EDGE;
+		 edge_id = backward_.prevs[data_.edges[edge_id].to]) {
+	  hierarchy_edges.push_back(edge_id);
+	}
+	forward_.Reset();
+	backward_.Reset();
+
+	std::vector<EdgeId> edges;
+	for (const EdgeId edge_id : hierarchy_edges) {
+	  UnpackEdge(edge_id, edges);
+	}
+	return RouteInfo {*best_weight, std::move(edges)};
+  }
+
+  template <typename Weight>
+  template <typename Visit>
+  void ContractionHierarchy<Weight>::RunUpwardSearch(SearchSpace& space, VertexId from,
+													 bool is_forward, const Visit& visit) const {
+	const auto& lists = is_forward ? data_.upward : data_.downward;
+	space.Reach(from, ZERO_WEIGHT, NO_EDGE);
+	while (!space.heap.empty()) {
+	  const QueueItem item = space.Pop();
+	  if (item.weight > space.weights[item.vertex]) {
+		continue;
+	  }
+	  visit(item.vertex, item.weight);
+	  for (const EdgeId edge_id : lists[item.vertex]) {
+		const HierarchyEdge& edge = data_.edges[edge_id];
+		const VertexId next = is_forward ? edge.to : edge.from;
+		const Weight candidate_weight = item.weight + edge.weight;
+		if (space.IsImprovedBy(next, candidate_weight)) {
+		  space.Reach(next, candidate_weight, edge_id);
+		}
+	  }
+	}
+	space.Reset();
+  }
+
+  template <typename Weight>
+  std::vector<std::optional<Weight>> ContractionHierarchy<Weight>::BuildWeights(
+	  const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+	const size_t vertex_count = data_.upward.size();
+	for (const VertexId vertex : sources) {
+	  if (vertex >= vertex_count) {
+		throw std::out_of_range("Vertex is out of graph");
+	  }
+	}
+	for (const VertexId vertex : targets) {
+	  if (vertex >= vertex_count) {
+		throw std::out_of_range("Vertex is out of graph");
+	  }
+	}
+	forward_.Prepare(vertex_count);
+	backward_.Prepare(vertex_count);
+
+	struct BucketEntry {
+	  size_t target;
+	  Weight weight;
+	};
+	std::vector<std::pair<VertexId, BucketEntry>> entries;
+	for (size_t target = 0; target < targets.size(); ++target) {
+	  RunUpwardSearch(backward_, targets[target], false,
+					  [&entries, target](VertexId vertex, Weight weight) {
+						entries.push_back({vertex, {target, weight}});
+					  });
+	}
+	std::vector<size_t> bucket_offsets(vertex_count + 1, 0);
+	for (const auto& [vertex, entry] : entries) {
+	  ++bucket_offsets[vertex + 1];
+	}
+	std::partial_sum(bucket_offsets.begin(), bucket_offsets.end(), bucket_offsets.begin());
+	std::vector<BucketEntry> buckets(entries.size());
+	{
+	  std::vector<size_t> next_entry(bucket_offsets.begin(), std::prev(bucket_offsets.end()));
+	  for (const auto& [vertex, entry] : entries) {
+		buckets[next_entry[vertex]++] = entry;
+	  }
+	}
+
+	std::vector<std::optional<Weight>> result(sources.size() * targets.size());
+	for (size_t source = 0; source < sources.size(); ++source) {
+	  std::optional<Weight>* const row = result.data() + source * targets.size();
+	  RunUpwardSearch(forward_, sources[source], true,
+					  [&buckets, &bucket_offsets, row](VertexId vertex, Weight weight) {
+						for (size_t i = bucket_offsets[vertex]; i < bucket_offsets[vertex + 1];
+							 ++i) {
+						  const Weight candidate_weight = weight + buckets[i].weight;
+						  std::optional<Weight>& cell = row[buckets[i].target];
+						  if (!cell || candidate_weight < *cell) {
+							cell = candidate_weight;
+						  }
+						}
+					  });
+	}
+	return result;
+  }
+
+}  // namespace graph
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "min_plus.h"
+#include "radix_heap.h"
+#include "router.h"
+
+namespace graph {
+
+  /// Router without precomputation: keeps only the graph and answers every
+  /// BuildRoute with a Dijkstra search that stops once the target is settled.
+  /// With a lower bound set the search is A*: the queue is ordered by
+  /// weight + bound, and the bound must never overestimate the remaining weight.
+  /// A bound of NO_ROUTE means the target can't be reached from the vertex, the
+  /// vertex is not searched further. With an edge weight set the edges are
+  /// weighed by it at query time instead of by their stored weights.
+  /// Integer weights are queued in a radix heap, the bound must then be consistent.
+  /// Scratch buffers are reused between queries, so a router instance must not
+  /// be shared between threads.
+  template <typename Weight>
+  class DijkstraRouter {
+  private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+  public:
+	explicit DijkstraRouter(const Graph& graph) : graph_(graph) {}
+
+	using RouteInfo = typename Router<Weight>::RouteInfo;
+	using LowerBound = std::function<Weight(VertexId vertex, VertexId to)>;
+
+	using EdgeWeight = std::function<Weight(EdgeId edge_id)>;
+
+	static constexpr Weight NO_ROUTE = min_plus::NoRoute<Weight>();
+
+	void SetLowerBound(LowerBound lower_bound) {
+	  lower_bound_ = std::move(lower_bound);
+	}
+
+	void SetEdgeWeight(EdgeWeight edge_weight) {
+	  edge_weight_ = std::move(edge_weight);
+	}
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	/// One search per source that stops once every target is settled; the lower
+	/// bound is not used. Row-major by source, std::nullopt where there is no route.
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+													const std::vector<VertexId>& targets) const;
+	/// Vertices reachable from the vertex with weight at most max_weight, in
+	/// order of weight; the search stops once the next weight exceeds it.
+	std::vector<std::pair<VertexId, Weight>> BuildWeightsWithin(VertexId from,
+																Weight max_weight) const;
+
+  private:
+	struct QueueItem {
+	  Weight key;
+	  Weight weight;
+	  VertexId vertex;
+
+	  bool operator>(const QueueItem& other) const {
+		return key > other.key;
+	  }
+	};
+
+	void PrepareScratch(size_t vertex_count) const {
+	  if (weights_.size() != vertex_count) {
+		weights_.assign(vertex_count, ZERO_WEIGHT);
+		bounds_.assign(vertex_count, ZERO_WEIGHT);
+		prev_edges_.assign(vertex_count, NO_EDGE);
+		reached_.assign(vertex_count, false);
+		pending_targets_.assign(vertex_count, false);
+		touched_.clear();
+	  }
+	}
+
+	Weight GetEdgeWeight(EdgeId edge_id) const {
+	  return edge_weight_ ? edge_weight_(edge_id) : graph_.GetEdge(edge_id).weight;
+	}
+
+	void ResetScratch() const {
+	  for (const VertexId vertex : touched_) {
+		reached_[vertex] = false;
+	  }
+	  touched_.clear();
+	  if constexpr (std::is_integral_v<Weight>) {
+		radix_heap_.Clear();
+	  } else {
+		heap_.clear();
+	  }
+	}
+
+	bool IsQueueEmpty() const {
+	  if constexpr (std::is_integral_v<Weight>) {
+		return radix_heap_.IsEmpty();
+	  } else {
+		return heap_.empty();
+	  }
+	}
+
+	QueueItem PopQueue() const {
+	  if constexpr (std::is_integral_v<Weight>) {
+		return radix_heap_.Pop().second;
+	  } else {
+		std::pop_heap(heap_.begin(), heap_.end(), std::greater<QueueItem> {});
+		const QueueItem item = heap_.back();
+		heap_.pop_back();
+		return item;
+	  }
+	}
+
+	void Reach(VertexId vertex, Weight weight, EdgeId prev_edge, VertexId to) const {
+	  if (!reached_[vertex]) {
+		reached_[vertex] = true;
+		touched_.push_back(vertex);
+		bounds_[vertex]
+			= lower_bound_ && to != NO_VERTEX ? lower_bound_(vertex, to) : ZERO_WEIGHT;
+	  }
+	  weights_[vertex] = weight;
+	  prev_edges_[vertex] = prev_edge;
+	  if (bounds_[vertex] == NO_ROUTE) {
+		return;
+	  }
+	  const QueueItem item {weight + bounds_[vertex], weight, vertex};
+	  if constexpr (std::is_integral_v<Weight>) {
+		radix_heap_.Push(item.key, item);
+	  } else {
+		heap_.push_back(item);
+		std::push_heap(heap_.begin(), heap_.end(), std::greater<QueueItem> {});
+	  }
+	}
+
+	static constexpr Weight ZERO_WEIGHT {};
+	static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+	static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+	const Graph& graph_;
+	LowerBound lower_bound_;
+	EdgeWeight edge_weight_;
+
+	mutable std::vector<Weight> weights_;
+	mutable std::vector<Weight> bounds_;
+	mutable std::vector<EdgeId> prev_edges_;
+	mutable std::vector<bool> reached_;
+	mutable std::vector<bool> pending_targets_;
+	mutable std::vector<VertexId> touched_;
+	mutable std::vector<QueueItem> heap_;
+	mutable RadixHeap<std::make_unsigned_t<std::conditional_t<std::is_integral_v<Weight>, Weight, int>>,
+					  QueueItem>
+		radix_heap_;
+  };
+
+  template <typename Weight>
+  std::optional<typename DijkstraRouter<Weight>::RouteInfo>
+  DijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count || to >= vertex_count) {
+	  throw std::out_of_range("Vertex is out of graph");
+	}
+	PrepareScratch(vertex_count);
+
+	Reach(from, ZERO_WEIGHT, NO_EDGE, to);
+	while (!IsQueueEmpty()) {
+	  const QueueItem item = PopQueue();
+	  if (item.weight > weights_[item.vertex]) {
+		continue;
+	  }
+	  if (item.vertex == to) {
+		break;
+	  }
+	  for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+		const auto& edge = graph_.GetEdge(edge_id);
+		const Weight edge_weight = GetEdgeWeight(edge_id);
+		if (edge_weight < ZERO_WEIGHT) {
+		  ResetScratch();
+		  throw std::domain_error("Edges' weights should be non-negative");
+		}
+		const Weight candidate_weight = item.weight + edge_weight;
+		if (!reached_[edge.to] || candidate_weight < weights_[edge.to]) {
+		  Reach(edge.to, candidate_weight, edge_id, to);
+		}
+	  }
+	}
+
+	if (!reached_[to]) {
+	  ResetScratch();
+	  return std::nullopt;
+	}
+	const Weight weight = weights_[to];
+	std::vector<EdgeId> edges;
+	for (EdgeId edge_id = prev_edges_[to]; edge_id != NO_EDGE;
+		 edge_id = prev_edges_[graph_.GetEdge(edge_id).from]) {
+	  edges.push_back(edge_id);
+	}
+	std::reverse(edges.begin(), edges.end());
+	ResetScratch();
+
+	return RouteInfo {weight, std::move(edges)};
+  }
+
+  template <typename Weight>
+  std::vector<std::optional<Weight>> DijkstraRouter<Weight>::BuildWeights(
+	  const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	for (const VertexId vertex : sources) {
+	  if (vertex >= vertex_count) {
+		throw std::out_of_range("Vertex is out of graph");
+	  }
+	}
+	for (const VertexId vertex : targets) {
+	  if (vertex >= vertex_count) {
+		throw std::out_of_range("Vertex is out of graph");
+	  }
+	}
+	PrepareScratch(vertex_count);
+
+	std::vector<std::optional<Weight>> result;
+	result.reserve(sources.size() * targets.size());
+	for (const VertexId from : sources) {
+	  size_t pending_count = 0;
+	  for (const VertexId to : targets) {
+		if (!pending_targets_[to]) {
+		  pending_targets_[to] = true;
+		  ++pending_count;
+		}
+	  }
+	  Reach(from, ZERO_WEIGHT, NO_EDGE, NO_VERTEX);
+	  while (!IsQueueEmpty() && pending_count > 0) {
+		const QueueItem item = PopQueue();
+		if (item.weight > weights_[item.vertex]) {
+		  continue;
+		}
+		if (pending_targets_[item.vertex]) {
+		  pending_targets_[item.vertex] = false;
+		  --pending_count;
+		}
+		for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+		  const auto& edge = graph_.GetEdge(edge_id);
+		  const Weight edge_weight = GetEdgeWeight(edge_id);
+		  if (edge_weight < ZERO_WEIGHT) {
+			for (const VertexId to : targets) {
+			  pending_targets_[to] = false;
+			}
+			ResetScratch();
+			throw std::domain_error("Edges' weights should be non-negative");
+		  }
+		  const Weight candidate_weight = item.weight + edge_weight;
+		  if (!reached_[edge.to] || candidate_weight < weights_[edge.to]) {
+			Reach(edge.to, candidate_weight, edge_id, NO_VERTEX);
+		  }
+		}
+	  }
+	  for (const VertexId to : targets) {
+		pending_targets_[to] = false;
+		if (reached_[to]) {
+		  result.emplace_back(weights_[to]);
+		} else {
+		  result.emplace_back();
+		}
+	  }
+	  ResetScratch();
+	}
+	return result;
+  }
+
+  template <typename Weight>
+  std::vector<std::pair<VertexId, Weight>> DijkstraRouter<Weight>::BuildWeightsWithin(
+	  VertexId from, Weight max_weight) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count) {
+	  throw std::out_of_range("Vertex is out of graph");
+	}
+	PrepareScratch(vertex_count);
+
+	std::vector<std::pair<VertexId, Weight>> result;
+	Reach(from, ZERO_WEIGHT, NO_EDGE, NO_VERTEX);
+	while (!IsQueueEmpty()) {
+	  const QueueItem item = PopQueue();
+	  if (item.weight > weights_[item.vertex]) {
+		continue;
+	  }
+	  if (max_weight < item.weight) {
+		break;
+	  }
+	  result.emplace_back(item.vertex, item.weight);
+	  for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+		const auto& edge = graph_.GetEdge(edge_id);
+		const Weight edge_weight = GetEdgeWeight(edge_id);
+		if (edge_weight < ZERO_WEIGHT) {
+		  ResetScratch();
+		  throw std::domain_error("Edges' weights should be non-negative");
+		}
+		const Weight candidate_weight = item.weight + edge_weight;
+		if (!(max_weight < candidate_weight)
+			&& (!reached_[edge.to] || candidate_weight < weights_[edge.to])) {
+		  Reach(edge.to, candidate_weight, edge_id, NO_VERTEX);
+		}
+	  }
+	}
+	ResetScratch();
+	return result;
+  }
+
+}  // namespace graph
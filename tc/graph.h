@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 
 #include "ranges.h"
@@ -19,10 +21,13 @@ namespace graph {
 
   using IncidenceList = std::vector<EdgeId>;
 
+  /// Built with AddEdge, then frozen into compressed sparse row form: edges are
+  /// stably sorted by source, so the incident edges of a vertex are the id span
+  /// [offsets[v], offsets[v + 1]). Searches need a frozen graph.
   template <typename Weight>
   class DirectedWeightedGraph {
   public:
-	using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+	using IncidentEdgesRange = ranges::Range<ranges::CountingIterator<EdgeId>>;
 
 	DirectedWeightedGraph() = default;
 	explicit DirectedWeightedGraph(size_t vertex_count)
@@ -32,6 +37,12 @@ namespace graph {
 
 	void ResizeIncidenceLists(size_t vertex_count);
 
+	/// Switches to CSR form. Returns the new id of every edge by its old id.
+	std::vector<EdgeId> Freeze();
+	/// Back to the build form to add edges; edge ids are kept until the next Freeze.
+	void Unfreeze();
+	bool IsFrozen() const;
+
 	size_t GetVertexCount() const;
 	size_t GetEdgeCount() const;
 
@@ -39,21 +50,27 @@ namespace graph {
 	IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
 	std::vector<Edge<Weight>>& ModifyEdges();
-	std::vector<IncidenceList>& ModifyIncidenceLists();
+	std::vector<EdgeId>& ModifyOffsets();
+	const std::vector<EdgeId>& GetOffsets() const;
 
   private:
 	std::vector<Edge<Weight>> edges_;
 	std::vector<IncidenceList> incidence_lists_;
+	std::vector<EdgeId> offsets_;
   };
 
   template <typename Weight>
   EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+	if (IsFrozen()) {
+	  throw std::logic_error("Can't add an edge to a frozen graph");
+	}
 	edges_.push_back(edge);
 	const EdgeId id = edges_.size() - 1;
-	if (incidence_lists_.size() <= edge.from) {
-	  incidence_lists_.resize(2 * edge.from + 1);
+	const VertexId max_vertex = std::max(edge.from, edge.to);
+	if (incidence_lists_.size() <= max_vertex) {
+	  incidence_lists_.resize(max_vertex + 1);
 	}
-	incidence_lists_.at(edge.from).push_back(id);
+	incidence_lists_[edge.from].push_back(id);
 	return id;
   }
 
@@ -62,9 +79,54 @@ namespace graph {
 	incidence_lists_.resize(vertex_count);
   }
 
+  template <typename Weight>
+  std::vector<EdgeId> DirectedWeightedGraph<Weight>::Freeze() {
+	std::vector<EdgeId> new_ids(edges_.size());
+	if (IsFrozen()) {
+	  for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+		new_ids[edge_id] = edge_id;
+	  }
+	  return new_ids;
+	}
+	std::vector<Edge<Weight>> edges;
+	edges.reserve(edges_.size());
+	offsets_.reserve(incidence_lists_.size() + 1);
+	for (const IncidenceList& list : incidence_lists_) {
+	  offsets_.push_back(edges.size());
+	  for (const EdgeId edge_id : list) {
+		new_ids[edge_id] = edges.size();
+		edges.push_back(edges_[edge_id]);
+	  }
+	}
+	offsets_.push_back(edges.size());
+	edges_ = std::move(edges);
+	incidence_lists_.clear();
+	incidence_lists_.shrink_to_fit();
+	return new_ids;
+  }
+
+  template <typename Weight>
+  void DirectedWeightedGraph<Weight>::Unfreeze() {
+	if (!IsFrozen()) {
+	  return;
+	}
+	incidence_lists_.assign(offsets_.size() - 1, {});
+	for (VertexId vertex = 0; vertex + 1 < offsets_.size(); ++vertex) {
+	  for (EdgeId edge_id = offsets_[vertex]; edge_id < offsets_[vertex + 1]; ++edge_id) {
+		incidence_lists_[vertex].push_back(edge_id);
+	  }
+	}
+	offsets_.clear();
+  }
+
+  template <typename Weight>
+  bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+	return !offsets_.empty();
+  }
+
   template <typename Weight>
   size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-	return incidence_lists_.size();
+	return IsFrozen() ? offsets_.size() - 1 : incidence_lists_.size();
   }
 
   template <typename Weight>
@@ -74,21 +136,30 @@ namespace graph {
 
   template <typename Weight>
   const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-	return edges_.at(edge_id);
+	return edges_[edge_id];
   }
 
   template <typename Weight>
   typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
   DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-	return ranges::AsRange(incidence_lists_.at(vertex));
+	if (!IsFrozen()) {
+	  throw std::logic_error("Graph should be frozen before searching");
+	}
+	return ranges::AsCountingRange(offsets_[vertex], offsets_[vertex + 1]);
   }
 
   template <typename Weight>
   std::vector<Edge<Weight>>& DirectedWeightedGraph<Weight>::ModifyEdges() {
 	return edges_;
   }
+
+  template <typename Weight>
+  std::vector<EdgeId>& DirectedWeightedGraph<Weight>::ModifyOffsets() {
+	return offsets_;
+  }
+
   template <typename Weight>
-  std::vector<IncidenceList>& DirectedWeightedGraph<Weight>::ModifyIncidenceLists() {
-	return incidence_lists_;
+  const std::vector<EdgeId>& DirectedWeightedGraph<Weight>::GetOffsets() const {
+	return offsets_;
   }
 }  // namespace graph
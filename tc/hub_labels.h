@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "router.h"
+
+namespace graph {
+
+  /// 2-hop labels over a DirectedWeightedGraph, built by pruned landmark
+  /// labeling: every vertex keeps the hubs it reaches (forward label) and the
+  /// hubs reaching it (backward label) with the weights, and every shortest path
+  /// passes a hub common to the labels of its ends. A query is a merge-join of
+  /// two labels sorted by hub rank; the path is unpacked by the first (forward)
+  /// or last (backward) edge stored with every entry. Memory is the total label
+  /// size instead of the V^2 table.
+  template <typename Weight>
+  class HubLabels {
+  private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+  public:
+	explicit HubLabels(const Graph& graph);
+
+	using RouteInfo = typename Router<Weight>::RouteInfo;
+	using HubRank = uint32_t;
+
+	static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+	/// Labels of vertex v are the entries [offsets[v], offsets[v + 1]), sorted by
+	/// hub rank. The edge leads from the vertex towards the hub in a forward
+	/// label and into the vertex from the hub side in a backward one, NO_EDGE in
+	/// the entry of the hub itself.
+	struct LabelSet {
+	  std::vector<size_t> offsets;
+	  std::vector<HubRank> hubs;
+	  std::vector<Weight> weights;
+	  std::vector<EdgeId> edges;
+	};
+
+	struct LabelData {
+	  LabelSet forward;
+	  LabelSet backward;
+	};
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	/// Merge-join per pair. Row-major by source, std::nullopt where there is no route.
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+													const std::vector<VertexId>& targets) const;
+
+	LabelData& ModifyLabelData() {
+	  return data_;
+	}
+
+	const LabelData& GetLabelData() const {
+	  return data_;
+	}
+
+  private:
+	struct QueueItem {
+	  Weight weight;
+	  VertexId vertex;
+
+	  bool operator>(const QueueItem& other) const {
+		return weight > other.weight;
+	  }
+	};
+
+	struct LabelEntry {
+	  HubRank hub;
+	  Weight weight;
+	  EdgeId edge;
+	};
+
+	struct Meeting {
+	  Weight weight;
+	  size_t forward_entry;
+	  size_t backward_entry;
+	};
+
+	/// Vertices with many incident edges first: they lie on the most shortest paths.
+	std::vector<VertexId> OrderVertices() const;
+	/// Pruned Dijkstra from the hub, over the reversed edges when is_forward is
+	/// unset. Adds the hub to the backward labels of the settled vertices, or to
+	/// the forward labels; a vertex already covered by the earlier hubs is
+	/// neither labeled nor expanded.
+	void RunPrunedSearch(const std::vector<std::vector<EdgeId>>& in_edges, VertexId hub,
+						 HubRank rank, bool is_forward,
+						 std::vector<std::vector<LabelEntry>>& forward,
+						 std::vector<std::vector<LabelEntry>>& backward);
+	static void FlattenLabels(std::vector<std::vector<LabelEntry>>& labels, LabelSet& set);
+	std::optional<Meeting> FindMeeting(VertexId from, VertexId to) const;
+	size_t FindEntry(const LabelSet& set, VertexId vertex, HubRank hub) const;
+
+	static constexpr Weight ZERO_WEIGHT {};
+
+	const Graph& graph_;
+	LabelData data_;
+
+	/// Construction scratch: weight to every hub of the current one's label, by rank.
+	std::vector<std::optional<Weight>> hub_weights_;
+	std::vector<Weight> weights_;
+	std::vector<EdgeId> prev_edges_;
+	std::vector<bool> reached_;
+	std::vector<VertexId> touched_;
+	std::vector<QueueItem> heap_;
+  };
+
+  template <typename Weight>
+  HubLabels<Weight>::HubLabels(const Graph& graph) : graph_(graph) {
+	const size_t vertex_count = graph.GetVertexCount();
+	std::vector<std::vector<EdgeId>> in_edges(vertex_count);
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+	  const auto& edge = graph.GetEdge(edge_id);
+	  if (edge.weight < ZERO_WEIGHT) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	  in_edges[edge.to].push_back(edge_id);
+	}
+
+	hub_weights_.assign(vertex_count, std::nullopt);
+	weights_.assign(vertex_count, ZERO_WEIGHT);
+	prev_edges_.assign(vertex_count, NO_EDGE);
+	reached_.assign(vertex_count, false);
+
+	std::vector<std::vector<LabelEntry>> forward(vertex_count);
+	std::vector<std::vector<LabelEntry>> backward(vertex_count);
+	const std::vector<VertexId> order = OrderVertices();
+	for (HubRank rank = 0; rank < order.size(); ++rank) {
+	  RunPrunedSearch(in_edges, order[rank], rank, true, forward, backward);
+	  RunPrunedSearch(in_edges, order[rank], rank, false, forward, backward);
+	}
+	FlattenLabels(forward, data_.forward);
+	FlattenLabels(backward, data_.backward);
+
+	hub_weights_ = {};
+	weights_ = {};
+	prev_edges_ = {};
+	reached_ = {};
+  }
+
+  template <typename Weight>
+  std::vector<VertexId> HubLabels<Weight>::OrderVertices() const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	std::vector<size_t> degrees(vertex_count, 0);
+	for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+	  ++degrees[graph_.GetEdge(edge_id).from];
+	  ++degrees[graph_.GetEdge(edge_id).to];
+	}
+	std::vector<VertexId> order(vertex_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&degrees](VertexId lhs, VertexId rhs) {
+	  return degrees[lhs] > degrees[rhs];
+	});
+	return order;
+  }
+
+  template <typename Weight>
+  void HubLabels<Weight>::RunPrunedSearch(const std::vector<std::vector<EdgeId>>& in_edges,
+										  VertexId hub, HubRank rank, bool is_forward,
+										  std::vector<std::vector<LabelEntry>>& forward,
+										  std::vector<std::vector<LabelEntry>>& backward) {
+	/// searching forward the hub is the start of the paths: its forward label
+	/// meets the backward labels of the reached vertices, and the other way round
+	auto& hub_labels = is_forward ? forward : backward;
+	auto& reached_labels = is_forward ? backward : forward;
+	for (const LabelEntry& entry : hub_labels[hub]) {
+	  hub_weights_[entry.hub] = entry.weight;
+	}
+
+	auto reach = [this](VertexId vertex, Weight weight, EdgeId prev_edge) {
+	  if (!reached_[vertex]) {
+		reached_[vertex] = true;
+		touched_.push_back(vertex);
+	  }
+	  weights_[vertex] = weight;
+	  prev_edges_[vertex] = prev_edge;
+	  heap_.push_back({weight, vertex});
+	  std::push_heap(heap_.begin(), heap_.end(), std::greater<QueueItem> {});
+	};
+	reach(hub, ZERO_WEIGHT, NO_EDGE);
+	while (!heap_.empty()) {
+	  std::pop_heap(heap_.begin(), heap_.end(), std::greater<QueueItem> {});
+	  const QueueItem item = heap_.back();
+	  heap_.pop_back();
+	  if (item.weight > weights_[item.vertex]) {
+		continue;
+	  }
+	  std::vector<LabelEntry>& label = reached_labels[item.vertex];
+	  const bool is_covered
+		  = std::any_of(label.begin(), label.end(), [this, &item](const LabelEntry& entry) {
+			  const std::optional<Weight>& hub_weight = hub_weights_[entry.hub];
+			  return hub_weight && !(item.weight < *hub_weight + entry.weight);
+			});
+	  if (is_covered) {
+		continue;
+	  }
+	  label.push_back({rank, item.weight, prev_edges_[item.vertex]});
+
+	  auto relax = [this, &item, &reach](EdgeId edge_id, VertexId next) {
+		const Weight candidate_weight = item.weight + graph_.GetEdge(edge_id).weight;
+		if (!reached_[next] || candidate_weight < weights_[next]) {
+		  reach(next, candidate_weight, edge_id);
+		}
+	  };
+	  if (is_forward) {
+		for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+		  relax(edge_id, graph_.GetEdge(edge_id).to);
+		}
+	  } else {
+		for (const EdgeId edge_id : in_edges[item.vertex]) {
+		  relax(edge_id, graph_.GetEdge(edge_id).from);
+		}
+	  }
+	}
+
+	for (const VertexId vertex : touched_) {
+	  reached_[vertex] = false;
+	}
+	touched_.clear();
+	for (const LabelEntry& entry : hub_labels[hub]) {
+	  hub_weights_[entry.hub] = std::nullopt;
+	}
+  }
+
+  template <typename Weight>
+  void HubLabels<Weight>::FlattenLabels(std::vector<std::vector<LabelEntry>>& labels,
+										LabelSet& set) {
+	set.offsets.assign(1, 0);
+	set.offsets.reserve(labels.size() + 1);
+	for (const auto& label : labels) {
+	  set.offsets.push_back(set.offsets.back() + label.size());
+	}
+	set.hubs.reserve(set.offsets.back());
+	set.weights.reserve(set.offsets.back());
+	set.edges.reserve(set.offsets.back());
+	for (auto& label : labels) {
+	  for (const LabelEntry& entry : label) {
+		set.hubs.push_back(entry.hub);
+		set.weights.push_back(entry.weight);
+		set.edges.push_back(entry.edge);
+	  }
+	  label = {};
+	}
+  }
+
+  template <typename Weight>
+  std::optional<typename HubLabels<Weight>::Meeting> HubLabels<Weight>::FindMeeting(
+	  VertexId from, VertexId to) const {
+	const LabelSet& forward = data_.forward;
+	const LabelSet& backward = data_.backward;
+	const size_t vertex_count = forward.offsets.size() - 1;
+	if (from >= vertex_count || to >= vertex_count) {
+	  throw std::out_of_range("Vertex is out of graph");
+	}
+	std::optional<Meeting> best;
+	size_t i = forward.offsets[from];
+	size_t j = backward.offsets[to];
+	while (i < forward.offsets[from + 1] && j < backward.offsets[to + 1]) {
+	  if (forward.hubs[i] < backward.hubs[j]) {
+		++i;
+	  } else if (backward.hubs[j] < forward.hubs[i]) {
+		++j;
+	  } else {
+		const Weight weight = forward.weights[i] + backward.weights[j];
+		if (!best || weight < best->weight) {
+		  best = Meeting {weight, i, j};
+		}
+		++i;
+		++j;
+	  }
+	}
+	return best;
+  }
+
+  template <typename Weight>
+  size_t HubLabels<Weight>::FindEntry(const LabelSet& set, VertexId vertex,
+									  HubRank hub) const {
+	const auto begin = set.hubs.begin() + set.offsets[vertex];
+	const auto end = set.hubs.begin() + set.offsets[vertex + 1];
+	const auto it = std::lower_bound(begin, end, hub);
+	if (it == end || *it != hub) {
+	  throw std::logic_error("Hub labels are inconsistent");
+	}
+	return it - set.hubs.begin();
+  }
+
+  template <typename Weight>
+  std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(
+	  VertexId from, VertexId to) const {
+	const std::optional<Meeting> meeting = FindMeeting(from, to);
+	if (!meeting) {
+	  return std::nullopt;
+	}
+	const HubRank hub = data_.forward.hubs[meeting->forward_entry];
+	std::vector<EdgeId> edges;
+	for (size_t entry = meeting->forward_entry; data_.forward.edges[entry] != NO_EDGE;) {
+	  const EdgeId edge_id = data_.forward.edges[entry];
+	  edges.push_back(edge_id);
+	  entry = FindEntry(data_.forward, graph_.GetEdge(edge_id).to, hub);
+	}
+	const size_t forward_size = edges.size();
+	for (size_t entry = meeting->backward_entry; data_.backward.edges[entry] != NO_EDGE;) {
+	  const EdgeId edge_id = data_.backward.edges[entry];
+	  edges.push_back(edge_id);
+	  entry = FindEntry(data_.backward, graph_.GetEdge(edge_id).from, hub);
+	}
+	std::reverse(edges.begin() + forward_size, edges.end());
+	return RouteInfo {meeting->weight, std::move(edges)};
+  }
+
+  template <typename Weight>
+  std::vector<std::optional<Weight>> HubLabels<Weight>::BuildWeights(
+	  const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+	std::vector<std::optional<Weight>> result;
+	result.reserve(sources.size() * targets.size());
+	for (const VertexId source : sources) {
+	  for (const VertexId target : targets) {
+		const std::optional<Meeting> meeting = FindMeeting(source, target);
+		if (meeting) {
+		  result.emplace_back(meeting->weight);
+		} else {
+		  result.emplace_back();
+		}
+	  }
+	}
+	return result;
+  }
+
+}  // namespace graph
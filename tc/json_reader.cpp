@@ -60,6 +60,23 @@ namespace jsoninputer {
 		stat.type_data = TypeData::ROUTE;
 		stat.route.from = dic.at("from"s).AsString();
 		stat.route.to = dic.at("to"s).AsString();
+		if (dic.count("routing_settings"s)) {
+		  const json::Dict& settings = dic.at("routing_settings"s).AsDict();
+		  if (settings.count("bus_wait_time"s)) {
+			stat.route.bus_wait_time = settings.at("bus_wait_time"s).AsInt();
+		  }
+		  if (settings.count("bus_velocity"s)) {
+			stat.route.bus_velocity_kmh = settings.at("bus_velocity"s).AsInt();
+		  }
+		}
+	  } else if (dic.at("type"s).AsString() == "Matrix"s) {
+		stat.type_data = TypeData::MATRIX;
+		stat.matrix.sources = StopsBus(dic.at("sources"s).AsArray());
+		stat.matrix.targets = StopsBus(dic.at("targets"s).AsArray());
+	  } else if (dic.at("type"s).AsString() == "Isochrone"s) {
+		stat.type_data = TypeData::ISOCHRONE;
+		stat.isochrone.from = dic.at("from"s).AsString();
+		stat.isochrone.max_time = dic.at("max_time"s).AsDouble();
 	  }
 	  return stat;
 	}
@@ -107,11 +124,106 @@ namespace jsoninputer {
 	  return res;
 	}
 
+	transport::RouterEngine RouterEngineMap(const std::string& name) {
+	  if (name == "floyd_warshall"s) {
+		return transport::RouterEngine::FLOYD_WARSHALL;
+	  } else if (name == "dijkstra"s) {
+		return transport::RouterEngine::DIJKSTRA;
+	  } else if (name == "contraction_hierarchy"s) {
+		return transport::RouterEngine::CONTRACTION_HIERARCHY;
+	  } else if (name == "raptor"s) {
+		return transport::RouterEngine::RAPTOR;
+	  } else if (name == "a_star"s) {
+		return transport::RouterEngine::A_STAR;
+	  } else if (name == "hub_labels"s) {
+		return transport::RouterEngine::HUB_LABELS;
+	  } else if (name == "partial"s) {
+		return transport::RouterEngine::PARTIAL;
+	  } else if (name == "overlay"s) {
+		return transport::RouterEngine::OVERLAY;
+	  }
+	  throw std::invalid_argument("Unknown router engine: "s + name);
+	}
+
+	/// The stops most often found as "from" of the recorded requests, ties by name.
+	std::vector<std::string> HotStopsOfQueryLog(const json::Array& query_log, size_t count) {
+	  std::map<std::string, size_t> from_counts;
+	  for (const auto& node : query_log) {
+		const json::Dict& request = node.AsDict();
+		if (request.count("from"s)) {
+		  ++from_counts[request.at("from"s).AsString()];
+		}
+	  }
+	  std::vector<std::pair<std::string, size_t>> stops(from_counts.begin(), from_counts.end());
+	  std::stable_sort(stops.begin(), stops.end(),
+					   [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+	  std::vector<std::string> res;
+	  for (size_t i = 0; i < std::min(count, stops.size()); ++i) {
+		res.push_back(std::move(stops[i].first));
+	  }
+	  return res;
+	}
+
 	transport::RouterSettings RouterMap(const json::Dict& dic) {
 	  using namespace detail;
 	  transport::RouterSettings res;
 	  res.bus_velocity_kmh = dic.at("bus_velocity"s).AsInt();
 	  res.bus_wait_time = dic.at("bus_wait_time"s).AsInt();
+	  if (dic.count("engine"s)) {
+		const std::string& engine = dic.at("engine"s).AsString();
+		res.auto_engine = engine == "auto"s;
+		if (!res.auto_engine) {
+		  res.engine = RouterEngineMap(engine);
+		}
+	  }
+	  if (dic.count("float_weights"s)) {
+		res.float_weights = dic.at("float_weights"s).AsBool();
+	  }
+	  if (dic.count("threads"s)) {
+		res.threads = dic.at("threads"s).AsInt();
+	  }
+	  if (dic.count("route_cache_size"s)) {
+		res.route_cache_size = dic.at("route_cache_size"s).AsInt();
+	  }
+	  if (dic.count("hot_stops"s)) {
+		for (const auto& node : dic.at("hot_stops"s).AsArray()) {
+		  res.hot_stops.push_back(node.AsString());
+		}
+	  }
+	  if (dic.count("query_log"s)) {
+		const size_t count
+			= dic.count("hot_stop_count"s) ? std::max(dic.at("hot_stop_count"s).AsInt(), 0) : 256;
+		for (std::string& stop : HotStopsOfQueryLog(dic.at("query_log"s).AsArray(), count)) {
+		  res.hot_stops.push_back(std::move(stop));
+		}
+	  }
+	  if (dic.count("promote_after"s)) {
+		res.promote_after = dic.at("promote_after"s).AsInt();
+	  }
+	  if (dic.count("overlay_cell_size"s)) {
+		res.overlay_cell_size = dic.at("overlay_cell_size"s).AsInt();
+	  }
+	  if (dic.count("overlay_levels"s)) {
+		res.overlay_levels = dic.at("overlay_levels"s).AsInt();
+	  }
+	  if (dic.count("landmark_count"s)) {
+		res.landmark_count = dic.at("landmark_count"s).AsInt();
+	  }
+	  if (dic.count("fixed_point_weights"s)) {
+		res.fixed_point_weights = dic.at("fixed_point_weights"s).AsBool();
+	  }
+	  if (dic.count("single_vertex_stops"s)) {
+		res.single_vertex_stops = dic.at("single_vertex_stops"s).AsBool();
+	  }
+	  if (dic.count("compact_graph"s)) {
+		res.compact_graph = dic.at("compact_graph"s).AsBool();
+	  }
+	  if (dic.count("memory_budget_mb"s)) {
+		res.memory_budget_mb = dic.at("memory_budget_mb"s).AsInt();
+	  }
+	  if (dic.count("build_time_budget_s"s)) {
+		res.build_time_budget_s = dic.at("build_time_budget_s"s).AsInt();
+	  }
 	  return res;
 	}
 
@@ -213,19 +325,21 @@ namespace jsoninputer {
 
   void JsonReader::PrintRoute(ostream& out, PreparedStat* s) const {
 	Builder request {};
-	const std::vector<transport_router::Edges>* edges_data = router_.GetEdgesData();
-	auto route_data = router_.GetRoute(s->route.from, s->route.to);
+	RouterSettings settings = router_.GetSettings();
+	settings.bus_wait_time = s->route.bus_wait_time.value_or(settings.bus_wait_time);
+	settings.bus_velocity_kmh = s->route.bus_velocity_kmh.value_or(settings.bus_velocity_kmh);
+	auto route_data = router_.GetRoute(s->route.from, s->route.to, settings);
 	request.StartDict().Key("request_id"s).Value(s->id);
-	if (route_data && route_data->edges.size() > 0) {
+	if (route_data && route_data->items.size() > 0) {
 	  request.Key("total_time"s).Value(route_data->weight).Key("items").StartArray();
-	  for (size_t edge_id : route_data->edges) {
-		std::string name {edges_data->at(edge_id).name};
-		if (edges_data->at(edge_id).type == edge_type::WAIT) {
+	  for (const transport_router::Edges& item : route_data->items) {
+		std::string name {item.name};
+		if (item.type == edge_type::WAIT) {
 		  request.StartDict()
 			  .Key("stop_name"s)
 			  .Value(name)
 			  .Key("time"s)
-			  .Value(edges_data->at(edge_id).time)
+			  .Value(item.time)
 			  .Key("type"s)
 			  .Value("Wait"s)
 			  .EndDict();
@@ -234,11 +348,11 @@ namespace jsoninputer {
 			  .Key("bus"s)
 			  .Value(name)
 			  .Key("time"s)
-			  .Value(edges_data->at(edge_id).time)
+			  .Value(item.time)
 			  .Key("type"s)
 			  .Value("Bus"s)
 			  .Key("span_count"s)
-			  .Value(static_cast<int>(edges_data->at(edge_id).span_count))
+			  .Value(static_cast<int>(item.span_count))
 			  .EndDict();
 		}
 	  }
@@ -252,6 +366,51 @@ namespace jsoninputer {
 	Print(Document {request.Build()}, out);
   }
 
+  /// Written straight to the stream, one row of numbers per line: a json::Node
+  /// per cell and an indented line per number do not scale to big matrices.
+  /// Numbers are formatted like json::Print does, null where there is no route.
+  void JsonReader::PrintMatrix(ostream& out, PreparedStat* s) const {
+	const std::vector<std::string_view> sources(s->matrix.sources.begin(),
+												s->matrix.sources.end());
+	const std::vector<std::string_view> targets(s->matrix.targets.begin(),
+												s->matrix.targets.end());
+	const std::vector<std::optional<double>> total_times
+		= router_.GetTravelTimes(sources, targets);
+	out << "{\n    \"request_id\": "sv << s->id << ",\n    \"total_times\": ["sv;
+	for (size_t row = 0; row < sources.size(); ++row) {
+	  out << (row == 0 ? "\n        ["sv : ",\n        ["sv);
+	  for (size_t column = 0; column < targets.size(); ++column) {
+		if (column != 0) {
+		  out << ", "sv;
+		}
+		const std::optional<double>& total_time = total_times[row * targets.size() + column];
+		if (total_time) {
+		  out << *total_time;
+		} else {
+		  out << "null"sv;
+		}
+	  }
+	  out << ']';
+	}
+	out << (sources.empty() ? "]\n}"sv : "\n    ]\n}"sv);
+  }
+
+  void JsonReader::PrintIsochrone(ostream& out, PreparedStat* s) const {
+	Builder request {};
+	request.StartDict().Key("request_id"s).Value(s->id).Key("stops"s).StartArray();
+	for (const auto& [stop_name, time] :
+		 router_.GetReachableStops(s->isochrone.from, s->isochrone.max_time)) {
+	  request.StartDict()
+		  .Key("stop_name"s)
+		  .Value(std::string {stop_name})
+		  .Key("time"s)
+		  .Value(time)
+		  .EndDict();
+	}
+	request.EndArray().EndDict();
+	Print(Document {request.Build()}, out);
+  }
+
   void JsonReader::PrintRequests(std::ostream& out, RequestHandler& request_handler) {
 	out << "["s << std::endl;
 	bool first = true;
@@ -268,6 +427,10 @@ namespace jsoninputer {
 		  PrintMap(out, s, request_handler);
 		} else if (s->type_data == TypeData::ROUTE) {
 		  PrintRoute(out, s);
+		} else if (s->type_data == TypeData::MATRIX) {
+		  PrintMatrix(out, s);
+		} else if (s->type_data == TypeData::ISOCHRONE) {
+		  PrintIsochrone(out, s);
 		}
 		first = false;
 	  }
@@ -299,7 +462,9 @@ namespace jsoninputer {
 		if (elem.AsDict().at("type"s).AsString() == "Bus"s
 			|| elem.AsDict().at("type"s).AsString() == "Stop"s
 			|| elem.AsDict().at("type"s).AsString() == "Map"s
-			|| elem.AsDict().at("type"s).AsString() == "Route"s) {
+			|| elem.AsDict().at("type"s).AsString() == "Route"s
+			|| elem.AsDict().at("type"s).AsString() == "Matrix"s
+			|| elem.AsDict().at("type"s).AsString() == "Isochrone"s) {
 		  requests_.emplace_back(
 			  std::make_unique<PreparedStat>(detail::Stat(elem.AsDict())));
 		}
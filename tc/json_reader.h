@@ -22,7 +22,7 @@ using namespace transport_router;
 
 namespace detail {
 enum class QueryType { BASE = 0, STAT, RENDER, EMPTY };
-enum class TypeData { BUS, STOP, MAP, ROUTE, EMPTY };
+enum class TypeData { BUS, STOP, MAP, ROUTE, MATRIX, ISOCHRONE, EMPTY };
 
 struct PreparedData {
   QueryType query_type = QueryType::EMPTY;
@@ -33,12 +33,27 @@ struct PreparedData {
 struct PreparedStatRoute {
   std::string from;
   std::string to;
+  /// routing_settings of the request, the router's ones where missing
+  std::optional<int> bus_wait_time;
+  std::optional<int> bus_velocity_kmh;
+};
+
+struct PreparedStatMatrix {
+  std::vector<std::string> sources;
+  std::vector<std::string> targets;
+};
+
+struct PreparedStatIsochrone {
+  std::string from;
+  double max_time = 0;
 };
 
 struct PreparedStat : public PreparedData {
   std::string name;
   int id = 0;
   PreparedStatRoute route;
+  PreparedStatMatrix matrix;
+  PreparedStatIsochrone isochrone;
 };
 
 struct PreparedStop : public PreparedData {
@@ -99,6 +114,8 @@ public:
   void PrintBus(ostream& out, PreparedStat* s) const;
   void PrintMap(ostream& out, PreparedStat* s, RequestHandler& request_handler) const;
   void PrintRoute(ostream& out, PreparedStat* s) const;
+  void PrintMatrix(ostream& out, PreparedStat* s) const;
+  void PrintIsochrone(ostream& out, PreparedStat* s) const;
 
 private:
   transport::TransportCatalogue& catalogue_;
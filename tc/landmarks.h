@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "min_plus.h"
+#include "parallel.h"
+
+namespace graph {
+
+  /// ALT lower bounds over a DirectedWeightedGraph: the weights from and to a few
+  /// landmarks give by the triangle inequality
+  ///   weight(v, t) >= weight(L, t) - weight(L, v) and weight(v, L) - weight(t, L).
+  /// Landmarks are picked by farthest-point selection, each one is the vertex
+  /// farthest (there and back) from the ones picked before, so the bounds hold
+  /// up on any network, not only where straight lines follow the roads.
+  /// Memory is O(k * V) for k landmarks.
+  template <typename Weight>
+  class Landmarks {
+  private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+  public:
+	static constexpr Weight NO_ROUTE = min_plus::NoRoute<Weight>();
+
+	/// Weights of vertex v are [v * k, (v + 1) * k) in the order of the
+	/// landmarks, NO_ROUTE where there is no route.
+	struct LandmarkData {
+	  std::vector<VertexId> landmarks;
+	  std::vector<Weight> weights_from;	 /// from the landmarks to the vertex
+	  std::vector<Weight> weights_to;	 /// from the vertex to the landmarks
+	};
+
+	Landmarks() = default;
+	Landmarks(const Graph& graph, size_t landmark_count, size_t thread_count = 1);
+
+	/// Keeps the landmarks and computes their weights again after the graph changed.
+	void Update(const Graph& graph, size_t thread_count = 1);
+
+	/// Never overestimates the weight from the vertex to the target; NO_ROUTE
+	/// when the landmarks show there is no route.
+	Weight GetLowerBound(VertexId vertex, VertexId to) const;
+
+	LandmarkData& ModifyLandmarkData() {
+	  return data_;
+	}
+
+	const LandmarkData& GetLandmarkData() const {
+	  return data_;
+	}
+
+  private:
+	/// Dijkstra search from the vertex over the edges, or against them if is_forward is false.
+	static std::vector<Weight> SearchWeights(const Graph& graph,
+											 const std::vector<std::vector<EdgeId>>& in_edges,
+											 VertexId from, bool is_forward);
+	static std::vector<std::vector<EdgeId>> GetInEdges(const Graph& graph);
+	void StoreWeights(const std::vector<std::vector<Weight>>& weights_from,
+					  const std::vector<std::vector<Weight>>& weights_to);
+
+	static constexpr Weight ZERO_WEIGHT {};
+
+	LandmarkData data_;
+  };
+
+  template <typename Weight>
+  Landmarks<Weight>::Landmarks(const Graph& graph, size_t landmark_count, size_t thread_count) {
+	const size_t vertex_count = graph.GetVertexCount();
+	landmark_count = std::min(landmark_count, vertex_count);
+	if (landmark_count == 0) {
+	  return;
+	}
+	const std::vector<std::vector<EdgeId>> in_edges = GetInEdges(graph);
+	std::vector<std::vector<Weight>> weights_from;
+	std::vector<std::vector<Weight>> weights_to;
+
+	/// weight there and back to the closest landmark, NO_ROUTE first; the search
+	/// from vertex 0 only seeds the first pick
+	std::vector<Weight> farthest_weights(vertex_count, NO_ROUTE);
+	auto pick_farthest = [&farthest_weights]() {
+	  return static_cast<VertexId>(
+		  std::max_element(farthest_weights.begin(), farthest_weights.end())
+		  - farthest_weights.begin());
+	};
+	farthest_weights = SearchWeights(graph, in_edges, 0, true);
+	std::replace(farthest_weights.begin(), farthest_weights.end(), NO_ROUTE, ZERO_WEIGHT);
+	std::vector<bool> is_landmark(vertex_count, false);
+	VertexId landmark = pick_farthest();
+	std::fill(farthest_weights.begin(), farthest_weights.end(), NO_ROUTE);
+	while (data_.landmarks.size() < landmark_count) {
+	  data_.landmarks.push_back(landmark);
+	  is_landmark[landmark] = true;
+	  std::vector<std::vector<Weight>> searches(2);
+	  parallel::ForEachIndex(2, thread_count, [&](size_t i) {
+		searches[i] = SearchWeights(graph, in_edges, landmark, i == 0);
+	  });
+	  for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+		const Weight from = searches[0][vertex];
+		const Weight to = searches[1][vertex];
+		const Weight round_trip = from == NO_ROUTE || to == NO_ROUTE ? NO_ROUTE : from + to;
+		farthest_weights[vertex] = is_landmark[vertex]
+									   ? ZERO_WEIGHT
+									   : std::min(farthest_weights[vertex], round_trip);
+	  }
+	  weights_from.push_back(std::move(searches[0]));
+	  weights_to.push_back(std::move(searches[1]));
+	  landmark = pick_farthest();
+	  if (is_landmark[landmark]) {
+		break;
+	  }
+	}
+	StoreWeights(weights_from, weights_to);
+  }
+
+  template <typename Weight>
+  void Landmarks<Weight>::Update(const Graph& graph, size_t thread_count) {
+	for (const VertexId landmark : data_.landmarks) {
+	  if (landmark >= graph.GetVertexCount()) {
+		throw std::out_of_range("Landmark is out of graph");
+	  }
+	}
+	const std::vector<std::vector<EdgeId>> in_edges = GetInEdges(graph);
+	const size_t landmark_count = data_.landmarks.size();
+	std::vector<std::vector<Weight>> searches(2 * landmark_count);
+	parallel::ForEachIndex(searches.size(), thread_count, [&](size_t i) {
+	  searches[i] = SearchWeights(graph, in_edges, data_.landmarks[i / 2], i % 2 == 0);
+	});
+	std::vector<std::vector<Weight>> weights_from;
+	std::vector<std::vector<Weight>> weights_to;
+	for (size_t i = 0; i < landmark_count; ++i) {
+	  weights_from.push_back(std::move(searches[2 * i]));
+	  weights_to.push_back(std::move(searches[2 * i + 1]));
+	}
+	StoreWeights(weights_from, weights_to);
+  }
+
+  template <typename Weight>
+  Weight Landmarks<Weight>::GetLowerBound(VertexId vertex, VertexId to) const {
+	const size_t landmark_count = data_.landmarks.size();
+	const size_t vertex_count
+		= landmark_count == 0 ? 0 : data_.weights_from.size() / landmark_count;
+	if (std::max(vertex, to) >= vertex_count) {
+	  return ZERO_WEIGHT;
+	}
+	const Weight* from_vertex = data_.weights_from.data() + vertex * landmark_count;
+	const Weight* from_target = data_.weights_from.data() + to * landmark_count;
+	const Weight* to_vertex = data_.weights_to.data() + vertex * landmark_count;
+	const Weight* to_target = data_.weights_to.data() + to * landmark_count;
+	Weight bound = ZERO_WEIGHT;
+	for (size_t i = 0; i < landmark_count; ++i) {
+	  /// the landmark reaches the vertex but not the target, or the target
+	  /// reaches the landmark but the vertex doesn't: no route
+	  if ((from_target[i] == NO_ROUTE && from_vertex[i] != NO_ROUTE)
+		  || (to_vertex[i] == NO_ROUTE && to_target[i] != NO_ROUTE)) {
+		return NO_ROUTE;
+	  }
+	  if (from_target[i] != NO_ROUTE && from_vertex[i] != NO_ROUTE) {
+		bound = std::max(bound, from_target[i] - from_vertex[i]);
+	  }
+	  if (to_vertex[i] != NO_ROUTE && to_target[i] != NO_ROUTE) {
+		bound = std::max(bound, to_vertex[i] - to_target[i]);
+	  }
+	}
+	return bound;
+  }
+
+  template <typename Weight>
+  std::vector<Weight> Landmarks<Weight>::SearchWeights(
+	  const Graph& graph, const std::vector<std::vector<EdgeId>>& in_edges, VertexId from,
+	  bool is_forward) {
+	std::vector<Weight> weights(graph.GetVertexCount(), NO_ROUTE);
+	std::vector<bool> settled(graph.GetVertexCount(), false);
+	using QueueItem = std::pair<Weight, VertexId>;
+	std::vector<QueueItem> heap;
+	auto relax = [&weights, &heap](VertexId vertex, Weight weight) {
+	  if (weight < weights[vertex]) {
+		weights[vertex] = weight;
+		heap.push_back({weight, vertex});
+		std::push_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+	  }
+	};
+	relax(from, ZERO_WEIGHT);
+	while (!heap.empty()) {
+	  std::pop_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+	  const auto [weight, vertex] = heap.back();
+	  heap.pop_back();
+	  if (settled[vertex]) {
+		continue;
+	  }
+	  settled[vertex] = true;
+	  if (is_forward) {
+		for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+		  const auto& edge = graph.GetEdge(edge_id);
+		  relax(edge.to, weight + edge.weight);
+		}
+	  } else {
+		for (const EdgeId edge_id : in_edges[vertex]) {
+		  const auto& edge = graph.GetEdge(edge_id);
+		  relax(edge.from, weight + edge.weight);
+		}
+	  }
+	}
+	return weights;
+  }
+
+  template <typename Weight>
+  std::vector<std::vector<EdgeId>> Landmarks<Weight>::GetInEdges(const Graph& graph) {
+	std::vector<std::vector<EdgeId>> in_edges(graph.GetVertexCount());
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+	  const auto& edge = graph.GetEdge(edge_id);
+	  if (edge.weight < ZERO_WEIGHT) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	  in_edges[edge.to].push_back(edge_id);
+	}
+	return in_edges;
+  }
+
+  template <typename Weight>
+  void Landmarks<Weight>::StoreWeights(const std::vector<std::vector<Weight>>& weights_from,
+									   const std::vector<std::vector<Weight>>& weights_to) {
+	const size_t landmark_count = weights_from.size();
+	const size_t vertex_count = landmark_count == 0 ? 0 : weights_from.front().size();
+	data_.weights_from.assign(vertex_count * landmark_count, NO_ROUTE);
+	data_.weights_to.assign(vertex_count * landmark_count, NO_ROUTE);
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+	  for (size_t i = 0; i < landmark_count; ++i) {
+		data_.weights_from[vertex * landmark_count + i] = weights_from[i][vertex];
+		data_.weights_to[vertex * landmark_count + i] = weights_to[i][vertex];
+	  }
+	}
+  }
+
+}  // namespace graph
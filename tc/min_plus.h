@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace graph {
+
+  using CompactEdgeId = uint32_t;
+
+  /// Row update of the all-pairs router:
+  ///   row[j] = min(row[j], weight_from + pivot[j]),
+  /// the previous edge is taken from the pivot row, or is prev_edge_from when the
+  /// pivot row has none. Missing routes are NoRoute (infinity for floating point),
+  /// so a missing pivot never wins the comparison.
+  namespace min_plus {
+
+	constexpr CompactEdgeId NO_EDGE = std::numeric_limits<CompactEdgeId>::max();
+
+	template <typename StoredWeight>
+	constexpr StoredWeight NoRoute() {
+	  return std::numeric_limits<StoredWeight>::has_infinity
+				 ? std::numeric_limits<StoredWeight>::infinity()
+				 : std::numeric_limits<StoredWeight>::max();
+	}
+
+	template <typename StoredWeight>
+	void RelaxRowScalar(StoredWeight* row_weights, CompactEdgeId* row_prev_edges,
+						const StoredWeight* pivot_weights,
+						const CompactEdgeId* pivot_prev_edges, size_t count,
+						StoredWeight weight_from, CompactEdgeId prev_edge_from) {
+	  for (size_t j = 0; j < count; ++j) {
+		const StoredWeight weight_to = pivot_weights[j];
+		if (weight_to == NoRoute<StoredWeight>()) {
+		  continue;
+		}
+		const StoredWeight candidate_weight = weight_from + weight_to;
+		if (candidate_weight < row_weights[j]) {
+		  const CompactEdgeId prev_edge_to = pivot_prev_edges[j];
+		  row_weights[j] = candidate_weight;
+		  row_prev_edges[j] = prev_edge_to != NO_EDGE ? prev_edge_to : prev_edge_from;
+		}
+	  }
+	}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	/// Previous edges for the lanes where mask is set, the old ones elsewhere.
+	inline __m128i BlendPrevEdges(__m128i mask, __m128i row_prev, __m128i pivot_prev,
+								  __m128i prev_from) {
+	  const __m128i no_edge = _mm_cmpeq_epi32(pivot_prev, _mm_set1_epi32(-1));
+	  const __m128i candidate_prev = _mm_or_si128(_mm_and_si128(no_edge, prev_from),
+												  _mm_andnot_si128(no_edge, pivot_prev));
+	  return _mm_or_si128(_mm_and_si128(mask, candidate_prev),
+						  _mm_andnot_si128(mask, row_prev));
+	}
+
+	inline void RelaxRowSimd(double* row_weights, CompactEdgeId* row_prev_edges,
+							 const double* pivot_weights,
+							 const CompactEdgeId* pivot_prev_edges, size_t count,
+							 double weight_from, CompactEdgeId prev_edge_from) {
+	  const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+	  size_t j = 0;
+#if defined(__AVX2__)
+	  const __m256d from = _mm256_set1_pd(weight_from);
+	  for (; j + 4 <= count; j += 4) {
+		const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(pivot_weights + j));
+		const __m256d row = _mm256_loadu_pd(row_weights + j);
+		const __m256d less = _mm256_cmp_pd(candidate, row, _CMP_LT_OQ);
+		if (_mm256_testz_pd(less, less)) {
+		  continue;
+		}
+		_mm256_storeu_pd(row_weights + j, _mm256_blendv_pd(row, candidate, less));
+		const __m256 less_ps = _mm256_castpd_ps(less);
+		const __m128i mask = _mm_castps_si128(
+			_mm_shuffle_ps(_mm256_castps256_ps128(less_ps), _mm256_extractf128_ps(less_ps, 1),
+						   _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i* const row_prev = reinterpret_cast<__m128i*>(row_prev_edges + j);
+		_mm_storeu_si128(
+			row_prev,
+			BlendPrevEdges(mask, _mm_loadu_si128(row_prev),
+						   _mm_loadu_si128(
+							   reinterpret_cast<const __m128i*>(pivot_prev_edges + j)),
+						   prev_from));
+	  }
+#else
+	  const __m128d from = _mm_set1_pd(weight_from);
+	  for (; j + 2 <= count; j += 2) {
+		const __m128d candidate = _mm_add_pd(from, _mm_loadu_pd(pivot_weights + j));
+		const __m128d row = _mm_loadu_pd(row_weights + j);
+		const __m128d less = _mm_cmplt_pd(candidate, row);
+		if (_mm_movemask_pd(less) == 0) {
+		  continue;
+		}
+		_mm_storeu_pd(row_weights + j, _mm_or_pd(_mm_and_pd(less, candidate),
+												 _mm_andnot_pd(less, row)));
+		const __m128 less_ps = _mm_castpd_ps(less);
+		const __m128i mask
+			= _mm_castps_si128(_mm_shuffle_ps(less_ps, less_ps, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i* const row_prev = reinterpret_cast<__m128i*>(row_prev_edges + j);
+		_mm_storel_epi64(
+			row_prev,
+			BlendPrevEdges(mask, _mm_loadl_epi64(row_prev),
+						   _mm_loadl_epi64(
+							   reinterpret_cast<const __m128i*>(pivot_prev_edges + j)),
+						   prev_from));
+	  }
+#endif
+	  RelaxRowScalar(row_weights + j, row_prev_edges + j, pivot_weights + j,
+					 pivot_prev_edges + j, count - j, weight_from, prev_edge_from);
+	}
+
+	inline void RelaxRowSimd(float* row_weights, CompactEdgeId* row_prev_edges,
+							 const float* pivot_weights,
+							 const CompactEdgeId* pivot_prev_edges, size_t count,
+							 float weight_from, CompactEdgeId prev_edge_from) {
+	  size_t j = 0;
+#if defined(__AVX2__)
+	  const __m256 from = _mm256_set1_ps(weight_from);
+	  const __m256i prev_from = _mm256_set1_epi32(static_cast<int>(prev_edge_from));
+	  const __m256i no_edge_value = _mm256_set1_epi32(-1);
+	  for (; j + 8 <= count; j += 8) {
+		const __m256 candidate = _mm256_add_ps(from, _mm256_loadu_ps(pivot_weights + j));
+		const __m256 row = _mm256_loadu_ps(row_weights + j);
+		const __m256 less = _mm256_cmp_ps(candidate, row, _CMP_LT_OQ);
+		if (_mm256_testz_ps(less, less)) {
+		  continue;
+		}
+		_mm256_storeu_ps(row_weights + j, _mm256_blendv_ps(row, candidate, less));
+		__m256i* const row_prev = reinterpret_cast<__m256i*>(row_prev_edges + j);
+		const __m256i pivot_prev
+			= _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pivot_prev_edges + j));
+		const __m256i candidate_prev = _mm256_blendv_epi8(
+			pivot_prev, prev_from, _mm256_cmpeq_epi32(pivot_prev, no_edge_value));
+		_mm256_storeu_si256(row_prev,
+							_mm256_blendv_epi8(_mm256_loadu_si256(row_prev), candidate_prev,
+											   _mm256_castps_si256(less)));
+	  }
+#else
+	  const __m128 from = _mm_set1_ps(weight_from);
+	  const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+	  for (; j + 4 <= count; j += 4) {
+		const __m128 candidate = _mm_add_ps(from, _mm_loadu_ps(pivot_weights + j));
+		const __m128 row = _mm_loadu_ps(row_weights + j);
+		const __m128 less = _mm_cmplt_ps(candidate, row);
+		if (_mm_movemask_ps(less) == 0) {
+		  continue;
+		}
+		_mm_storeu_ps(row_weights + j,
+					  _mm_or_ps(_mm_and_ps(less, candidate), _mm_andnot_ps(less, row)));
+		__m128i* const row_prev = reinterpret_cast<__m128i*>(row_prev_edges + j);
+		_mm_storeu_si128(
+			row_prev,
+			BlendPrevEdges(_mm_castps_si128(less), _mm_loadu_si128(row_prev),
+						   _mm_loadu_si128(
+							   reinterpret_cast<const __m128i*>(pivot_prev_edges + j)),
+						   prev_from));
+	  }
+#endif
+	  RelaxRowScalar(row_weights + j, row_prev_edges + j, pivot_weights + j,
+					 pivot_prev_edges + j, count - j, weight_from, prev_edge_from);
+	}
+#endif
+
+	/// Vectorized for float and double when the target has SSE2/AVX2, scalar
+	/// otherwise. Both paths do the same IEEE additions and comparisons, so the
+	/// results are identical.
+	template <typename StoredWeight>
+	void RelaxRow(StoredWeight* row_weights, CompactEdgeId* row_prev_edges,
+				  const StoredWeight* pivot_weights, const CompactEdgeId* pivot_prev_edges,
+				  size_t count, StoredWeight weight_from, CompactEdgeId prev_edge_from) {
+#if defined(__AVX2__) || defined(__SSE2__)
+	  if constexpr (std::is_same_v<StoredWeight, double>
+					|| std::is_same_v<StoredWeight, float>) {
+		RelaxRowSimd(row_weights, row_prev_edges, pivot_weights, pivot_prev_edges, count,
+					 weight_from, prev_edge_from);
+		return;
+	  }
+#endif
+	  RelaxRowScalar(row_weights, row_prev_edges, pivot_weights, pivot_prev_edges, count,
+					 weight_from, prev_edge_from);
+	}
+
+  }	 // namespace min_plus
+}  // namespace graph
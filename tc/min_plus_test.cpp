@@ -0,0 +1,76 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "min_plus.h"
+
+using namespace std::literals;
+
+namespace {
+
+  /// Relaxes random rows, with missing routes and pivot edges, by the scalar
+  /// loop and by RelaxRow and counts the cells where they differ.
+  template <typename StoredWeight>
+  int CompareRelaxRow(std::string_view name, std::mt19937& random) {
+	using graph::CompactEdgeId;
+	constexpr StoredWeight NO_ROUTE = graph::min_plus::NoRoute<StoredWeight>();
+	constexpr CompactEdgeId NO_EDGE = graph::min_plus::NO_EDGE;
+	std::uniform_real_distribution<StoredWeight> weights(0, 100);
+	std::uniform_int_distribution<CompactEdgeId> edges(0, 1000);
+	std::bernoulli_distribution missing(0.3);
+
+	int mismatches = 0;
+	for (int test = 0; test < 2000; ++test) {
+	  /// every tail length of the vector loops, offset from the aligned start
+	  const size_t count = test % 37;
+	  const size_t offset = test % 3;
+	  std::vector<StoredWeight> row(count + offset);
+	  std::vector<CompactEdgeId> row_prev(count + offset);
+	  std::vector<StoredWeight> pivot(count + offset);
+	  std::vector<CompactEdgeId> pivot_prev(count + offset);
+	  for (size_t j = 0; j < row.size(); ++j) {
+		row[j] = missing(random) ? NO_ROUTE : weights(random);
+		row_prev[j] = missing(random) ? NO_EDGE : edges(random);
+		pivot[j] = missing(random) ? NO_ROUTE : weights(random);
+		pivot_prev[j] = missing(random) ? NO_EDGE : edges(random);
+	  }
+	  /// equal candidates must keep the old cell on both paths
+	  if (count > 0) {
+		pivot[offset] = row[offset];
+	  }
+	  const StoredWeight weight_from = test % 5 == 0 ? StoredWeight {0} : weights(random);
+	  const CompactEdgeId prev_edge_from = edges(random);
+
+	  std::vector<StoredWeight> scalar_row = row;
+	  std::vector<CompactEdgeId> scalar_row_prev = row_prev;
+	  graph::min_plus::RelaxRowScalar(scalar_row.data() + offset, scalar_row_prev.data() + offset,
+									  pivot.data() + offset, pivot_prev.data() + offset, count,
+									  weight_from, prev_edge_from);
+	  graph::min_plus::RelaxRow(row.data() + offset, row_prev.data() + offset,
+								pivot.data() + offset, pivot_prev.data() + offset, count,
+								weight_from, prev_edge_from);
+	  if (row != scalar_row || row_prev != scalar_row_prev) {
+		++mismatches;
+	  }
+	}
+	std::cout << name << ": "sv << mismatches << " mismatched rows"sv << std::endl;
+	return mismatches;
+  }
+
+}  // namespace
+
+int main() {
+#if defined(__AVX2__)
+  std::cout << "AVX2 kernel"sv << std::endl;
+#elif defined(__SSE2__)
+  std::cout << "SSE2 kernel"sv << std::endl;
+#else
+  std::cout << "scalar kernel"sv << std::endl;
+#endif
+  std::mt19937 random(42);
+  const int mismatches
+	  = CompareRelaxRow<double>("double"sv, random) + CompareRelaxRow<float>("float"sv, random);
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,481 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "min_plus.h"
+#include "router.h"
+#include "search_space.h"
+
+namespace graph {
+
+  /// Multi-level overlay over a DirectedWeightedGraph and a nested partition of
+  /// its vertices: level 1 cells are the finest, every cell of level l + 1 must
+  /// be a union of level l cells. Every cell of a level keeps the weights from
+  /// its entries to its exits through the cell (the clique).
+  /// A query searches the original edges only in the cells of the ends and
+  /// the cliques of the highest level cells holding neither end elsewhere.
+  /// Clique arcs of a route are unpacked by a search inside their cell.
+  /// Queries and unpacking run in the one search space of the overlay, so
+  /// every thread needs an overlay of its own.
+  template <typename Weight>
+  class MultiLevelOverlay {
+  private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+  public:
+	using RouteInfo = typename Router<Weight>::RouteInfo;
+	using CellId = uint32_t;
+	/// Cells of every vertex by level, the finest level first.
+	using Partition = std::vector<std::vector<CellId>>;
+
+	static constexpr Weight NO_ROUTE = min_plus::NoRoute<Weight>();
+
+	/// Entries are the ends of edges from other cells, exits the starts of edges
+	/// to other cells, both sorted within a cell.
+	struct OverlayLevel {
+	  std::vector<CellId> cells;			/// by vertex
+	  std::vector<size_t> entry_offsets;	/// by cell, into entries
+	  std::vector<VertexId> entries;
+	  std::vector<size_t> exit_offsets;		/// by cell, into exits
+	  std::vector<VertexId> exits;
+	  std::vector<size_t> clique_offsets;	/// by cell, into clique_weights
+	  std::vector<Weight> clique_weights;	/// entries x exits per cell, row-major
+	};
+
+	struct OverlayData {
+	  std::vector<OverlayLevel> levels;	 /// level l + 1 at index l
+	};
+
+	MultiLevelOverlay(const Graph& graph, Partition partition);
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	/// One search per source that keeps the cells of all the targets open, as a
+	/// query keeps the cell of its end. Row-major by source, std::nullopt where
+	/// there is no route.
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+													const std::vector<VertexId>& targets) const;
+	/// Metric update after the weights of the edges have changed: only the
+	/// cliques of the cells holding them are computed again.
+	void UpdateEdges(const std::vector<EdgeId>& edges);
+
+	OverlayData& ModifyOverlayData() {
+	  return data_;
+	}
+
+	const OverlayData& GetOverlayData() const {
+	  return data_;
+	}
+
+  private:
+	static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+	static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+
+	/// An original edge, or a clique arc of the level when edge is NO_EDGE.
+	struct Arc {
+	  VertexId from;
+	  VertexId to;
+	  Weight weight;
+	  EdgeId edge;
+	  size_t level;
+	};
+
+	using SearchSpace = graph::SearchSpace<Weight, Arc>;
+	using QueueItem = typename SearchSpace::QueueItem;
+
+	/// Calls visit(arc) for the arcs leaving the vertex at the level: all its
+	/// original edges at level 0, otherwise the clique row of an entry and the
+	/// original edges to other cells.
+	template <typename Visit>
+	void ForEachArc(VertexId vertex, size_t level, const Visit& visit) const;
+	/// Highest level where the cell of the vertex holds neither end, 0 if none.
+	size_t GetQueryLevel(VertexId vertex, VertexId from, VertexId to) const;
+	/// Highest level where the cell of the vertex holds neither the source nor
+	/// a cell marked in target_cells (by level, then cell), 0 if none.
+	size_t GetQueryLevel(VertexId vertex, VertexId from,
+						 const std::vector<std::vector<bool>>& target_cells) const;
+	/// Dijkstra from the vertex, settled vertices are passed to settle(vertex,
+	/// weight) until it returns false. Arcs are taken at the level given by
+	/// arc_level(vertex) and followed while keep(vertex) is true.
+	template <typename ArcLevel, typename Keep, typename Settle>
+	void Search(VertexId from, const ArcLevel& arc_level, const Keep& keep,
+				const Settle& settle) const;
+	/// Search inside the cell of the vertex at the level over the arcs of the level below.
+	template <typename Settle>
+	void SearchCell(size_t level, VertexId from, const Settle& settle) const;
+	/// Weight of the route, the arcs stay in the search space.
+	std::optional<Weight> SearchRoute(VertexId from, VertexId to) const;
+	/// Path of arcs to the vertex settled by the last search.
+	std::vector<Arc> GetPrevArcs(VertexId to) const;
+	void UnpackArc(const Arc& arc, std::vector<EdgeId>& edges) const;
+	static size_t GetCount(const std::vector<size_t>& offsets, CellId cell) {
+	  return offsets[cell + 1] - offsets[cell];
+	}
+	static std::optional<size_t> FindIndex(const std::vector<size_t>& offsets,
+										   const std::vector<VertexId>& vertexes, CellId cell,
+										   VertexId vertex);
+	void BuildBoundary(size_t level);
+	void CustomizeCell(size_t level, CellId cell);
+
+	static constexpr Weight ZERO_WEIGHT {};
+
+	const Graph& graph_;
+	OverlayData data_;
+	mutable SearchSpace search_;
+  };
+
+  template <typename Weight>
+  MultiLevelOverlay<Weight>::MultiLevelOverlay(const Graph& graph, Partition partition)
+	  : graph_(graph) {
+	const size_t vertex_count = graph.GetVertexCount();
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+	  if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	}
+	data_.levels.resize(partition.size());
+	for (size_t level = 0; level < partition.size(); ++level) {
+	  if (partition[level].size() != vertex_count) {
+		throw std::invalid_argument("Partition doesn't cover the graph");
+	  }
+	  data_.levels[level].cells = std::move(partition[level]);
+	}
+	for (size_t level = 0; level < data_.levels.size(); ++level) {
+	  BuildBoundary(level);
+	  const size_t cell_count = data_.levels[level].clique_offsets.size() - 1;
+	  for (CellId cell = 0; cell < cell_count; ++cell) {
+		CustomizeCell(level + 1, cell);
+	  }
+	}
+  }
+
+  template <typename Weight>
+  void MultiLevelOverlay<Weight>::BuildBoundary(size_t level) {
+	OverlayLevel& overlay_level = data_.levels[level];
+	const std::vector<CellId>& cells = overlay_level.cells;
+	const size_t cell_count
+		= cells.empty() ? 0 : *std::max_element(cells.begin(), cells.end()) + 1;
+	std::vector<bool> is_entry(cells.size(), false);
+	std::vector<bool> is_exit(cells.size(), false);
+	for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+	  const auto& edge = graph_.GetEdge(edge_id);
+	  if (cells[edge.from] != cells[edge.to]) {
+		is_exit[edge.from] = true;
+		is_entry[edge.to] = true;
+	  }
+	}
+	auto group_by_cell = [&cells, cell_count](const std::vector<bool>& is_boundary,
+											   std::vector<size_t>& offsets,
+											   std::vector<VertexId>& vertexes) {
+	  offsets.assign(cell_count + 1, 0);
+	  for (VertexId vertex = 0; vertex < cells.size(); ++vertex) {
+		if (is_boundary[vertex]) {
+		  ++offsets[cells[vertex] + 1];
+		}
+	  }
+	  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	  vertexes.resize(offsets.back());
+	  std::vector<size_t> next_index(offsets.begin(), std::prev(offsets.end()));
+	  for (VertexId vertex = 0; vertex < cells.size(); ++vertex) {
+		if (is_boundary[vertex]) {
+		  vertexes[next_index[cells[vertex]]++] = vertex;
+		}
+	  }
+	};
+	group_by_cell(is_entry, overlay_level.entry_offsets, overlay_level.entries);
+	group_by_cell(is_exit, overlay_level.exit_offsets, overlay_level.exits);
+
+	overlay_level.clique_offsets.assign(cell_count + 1, 0);
+	for (CellId cell = 0; cell < cell_count; ++cell) {
+	  overlay_level.clique_offsets[cell + 1] = overlay_level.clique_offsets[cell]
+											   + GetCount(overlay_level.entry_offsets, cell)
+													 * GetCount(overlay_level.exit_offsets, cell);
+	}
+	overlay_level.clique_weights.assign(overlay_level.clique_offsets.back(), NO_ROUTE);
+  }
+
+  template <typename Weight>
+  std::optional<size_t> MultiLevelOverlay<Weight>::FindIndex(const std::vector<size_t>& offsets,
+															 const std::vector<VertexId>& vertexes,
+															 CellId cell, VertexId vertex) {
+	const auto begin = vertexes.begin() + offsets[cell];
+	const auto end = vertexes.begin() + offsets[cell + 1];
+	const auto it = std::lower_bound(begin, end, vertex);
+	if (it == end || *it != vertex) {
+	  return std::nullopt;
+	}
+	return it - begin;
+  }
+
+  template <typename Weight>
+  template <typename Visit>
+  void MultiLevelOverlay<Weight>::ForEachArc(VertexId vertex, size_t level,
+											 const Visit& visit) const {
+	if (level == 0) {
+	  for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+		const auto& edge = graph_.GetEdge(edge_id);
+		visit(Arc {vertex, edge.to, edge.weight, edge_id, 0});
+	  }
+	  return;
+	}
+	const OverlayLevel& overlay_level = data_.levels[level - 1];
+	const CellId cell = overlay_level.cells[vertex];
+	if (const auto index
+		= FindIndex(overlay_level.entry_offsets, overlay_level.entries, cell, vertex)) {
+	  const size_t first = overlay_level.exit_offsets[cell];
+	  const size_t exit_count = GetCount(overlay_level.exit_offsets, cell);
+	  const Weight* const row = overlay_level.clique_weights.data()
+								+ overlay_level.clique_offsets[cell] + *index * exit_count;
+	  for (size_t i = 0; i < exit_count; ++i) {
+		const VertexId exit = overlay_level.exits[first + i];
+		if (exit != vertex && row[i] != NO_ROUTE) {
+		  visit(Arc {vertex, exit, row[i], NO_EDGE, level});
+		}
+	  }
+	}
+	for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+	  const auto& edge = graph_.GetEdge(edge_id);
+	  if (overlay_level.cells[edge.to] != cell) {
+		visit(Arc {vertex, edge.to, edge.weight, edge_id, 0});
+	  }
+	}
+  }
+
+  template <typename Weight>
+  size_t MultiLevelOverlay<Weight>::GetQueryLevel(VertexId vertex, VertexId from,
+												  VertexId to) const {
+	for (size_t level = data_.levels.size(); level > 0; --level) {
+	  const std::vector<CellId>& cells = data_.levels[level - 1].cells;
+	  if (cells[vertex] != cells[from] && cells[vertex] != cells[to]) {
+		return level;
+	  }
+	}
+	return 0;
+  }
+
+  template <typename Weight>
+  size_t MultiLevelOverlay<Weight>::GetQueryLevel(
+	  VertexId vertex, VertexId from, const std::vector<std::vector<bool>>& target_cells) const {
+	for (size_t level = data_.levels.size(); level > 0; --level) {
+	  const std::vector<CellId>& cells = data_.levels[level - 1].cells;
+	  if (cells[vertex] != cells[from] && !target_cells[level - 1][cells[vertex]]) {
+		return level;
+	  }
+	}
+	return 0;
+  }
+
+  template <typename Weight>
+  template <typename ArcLevel, typename Keep, typename Settle>
+  void MultiLevelOverlay<Weight>::Search(VertexId from, const ArcLevel& arc_level,
+										 const Keep& keep, const Settle& settle) const {
+	search_.Prepare(graph_.GetVertexCount());
+	search_.Reset();
+	search_.Reach(from, ZERO_WEIGHT, Arc {NO_VERTEX, from, ZERO_WEIGHT, NO_EDGE, 0});
+	while (!search_.heap.empty()) {
+	  std::pop_heap(search_.heap.begin(), search_.heap.end(), std::greater<QueueItem> {});
+	  const QueueItem item = search_.heap.back();
+	  search_.heap.pop_back();
+	  if (item.weight > search_.weights[item.vertex]) {
+		continue;
+	  }
+	  if (!settle(item.vertex, item.weight)) {
+		return;
+	  }
+	  ForEachArc(item.vertex, arc_level(item.vertex), [this, &item, &keep](const Arc& arc) {
+		if (!keep(arc.to)) {
+		  return;
+		}
+		const Weight candidate_weight = item.weight + arc.weight;
+		if (search_.IsImprovedBy(arc.to, candidate_weight)) {
+		  search_.Reach(arc.to, candidate_weight, arc);
+		}
+	  });
+	}
+  }
+
+  template <typename Weight>
+  template <typename Settle>
+  void MultiLevelOverlay<Weight>::SearchCell(size_t level, VertexId from,
+											 const Settle& settle) const {
+	const std::vector<CellId>& cells = data_.levels[level - 1].cells;
+	const CellId cell = cells[from];
+	Search(
+		from, [level](VertexId) { return level - 1; },
+		[&cells, cell](VertexId vertex) { return cells[vertex] == cell; }, settle);
+  }
+
+  template <typename Weight>
+  std::vector<typename MultiLevelOverlay<Weight>::Arc> MultiLevelOverlay<Weight>::GetPrevArcs(
+	  VertexId to) const {
+	std::vector<Arc> arcs;
+	for (VertexId vertex = to; search_.prevs[vertex].from != NO_VERTEX;
+		 vertex = search_.prevs[vertex].from) {
+	  arcs.push_back(search_.prevs[vertex]);
+	}
+	std::reverse(arcs.begin(), arcs.end());
+	return arcs;
+  }
+
+  template <typename Weight>
+  void MultiLevelOverlay<Weight>::CustomizeCell(size_t level, CellId cell) {
+	OverlayLevel& overlay_level = data_.levels[level - 1];
+	const size_t entry_count = GetCount(overlay_level.entry_offsets, cell);
+	const size_t exit_count = GetCount(overlay_level.exit_offsets, cell);
+	Weight* const clique
+		= overlay_level.clique_weights.data() + overlay_level.clique_offsets[cell];
+	std::fill_n(clique, entry_count * exit_count, NO_ROUTE);
+	for (size_t i = 0; i < entry_count; ++i) {
+	  Weight* const row = clique + i * exit_count;
+	  size_t remaining = exit_count;
+	  SearchCell(level, overlay_level.entries[overlay_level.entry_offsets[cell] + i],
+				 [&](VertexId vertex, Weight weight) {
+				   if (const auto index = FindIndex(overlay_level.exit_offsets,
+													overlay_level.exits, cell, vertex)) {
+					 row[*index] = weight;
+					 --remaining;
+				   }
+				   return remaining > 0;
+				 });
+	}
+  }
+
+  template <typename Weight>
+  void MultiLevelOverlay<Weight>::UpdateEdges(const std::vector<EdgeId>& edges) {
+	std::vector<std::set<CellId>> changed_cells(data_.levels.size());
+	for (const EdgeId edge_id : edges) {
+	  const auto& edge = graph_.GetEdge(edge_id);
+	  if (edge.weight < ZERO_WEIGHT) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	  /// the cells holding both ends, a parent clique is built from the child ones
+	  for (size_t level = 0; level < data_.levels.size(); ++level) {
+		const std::vector<CellId>& cells = data_.levels[level].cells;
+		if (cells[edge.from] == cells[edge.to]) {
+		  changed_cells[level].insert(cells[edge.from]);
+		}
+	  }
+	}
+	for (size_t level = 0; level < data_.levels.size(); ++level) {
+	  for (const CellId cell : changed_cells[level]) {
+		CustomizeCell(level + 1, cell);
+	  }
+	}
+  }
+
+  template <typename Weight>
+  std::optional<Weight> MultiLevelOverlay<Weight>::SearchRoute(VertexId from,
+															   VertexId to) const {
+	std::optional<Weight> route_weight;
+	Search(
+		from, [this, from, to](VertexId vertex) { return GetQueryLevel(vertex, from, to); },
+		[](VertexId) { return true; },
+		[to, &route_weight](VertexId vertex, Weight weight) {
+		  if (vertex == to) {
+			route_weight = weight;
+		  }
+		  return vertex != to;
+		});
+	return route_weight;
+  }
+
+  template <typename Weight>
+  void MultiLevelOverlay<Weight>::UnpackArc(const Arc& arc, std::vector<EdgeId>& edges) const {
+	if (arc.edge != NO_EDGE) {
+	  edges.push_back(arc.edge);
+	  return;
+	}
+	SearchCell(arc.level, arc.from,
+			   [&arc](VertexId vertex, Weight) { return vertex != arc.to; });
+	for (const Arc& sub_arc : GetPrevArcs(arc.to)) {
+	  UnpackArc(sub_arc, edges);
+	}
+  }
+
+  template <typename Weight>
+  std::optional<typename MultiLevelOverlay<Weight>::RouteInfo>
+  MultiLevelOverlay<Weight>::BuildRoute(VertexId from, VertexId to) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count || to >= vertex_count) {
+	  throw std::out_of_range("Vertex is out of graph");
+	}
+	const std::optional<Weight> route_weight = SearchRoute(from, to);
+	if (!route_weight) {
+	  return std::nullopt;
+	}
+	std::vector<EdgeId> edges;
+	for (const Arc& arc : GetPrevArcs(to)) {
+	  UnpackArc(arc, edges);
+	}
+	return RouteInfo {*route_weight, std::move(edges)};
+  }
+
+  template <typename Weight>
+  std::vector<std::optional<Weight>> MultiLevelOverlay<Weight>::BuildWeights(
+	  const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	for (const VertexId vertex : sources) {
+	  if (vertex >= vertex_count) {
+		throw std::out_of_range("Vertex is out of graph");
+	  }
+	}
+	std::vector<std::vector<bool>> target_cells(data_.levels.size());
+	for (size_t level = 0; level < data_.levels.size(); ++level) {
+	  target_cells[level].assign(data_.levels[level].clique_offsets.size() - 1, false);
+	}
+	std::vector<bool> is_target(vertex_count, false);
+	size_t target_count = 0;
+	for (const VertexId vertex : targets) {
+	  if (vertex >= vertex_count) {
+		throw std::out_of_range("Vertex is out of graph");
+	  }
+	  if (!is_target[vertex]) {
+		is_target[vertex] = true;
+		++target_count;
+	  }
+	  for (size_t level = 0; level < data_.levels.size(); ++level) {
+		target_cells[level][data_.levels[level].cells[vertex]] = true;
+	  }
+	}
+
+	std::vector<std::optional<Weight>> result;
+	result.reserve(sources.size() * targets.size());
+	std::vector<bool> pending_targets;
+	for (const VertexId from : sources) {
+	  pending_targets = is_target;
+	  size_t remaining = target_count;
+	  Search(
+		  from,
+		  [this, from, &target_cells](VertexId vertex) {
+			return GetQueryLevel(vertex, from, target_cells);
+		  },
+		  [](VertexId) { return true; },
+		  [&pending_targets, &remaining](VertexId vertex, Weight) {
+			if (pending_targets[vertex]) {
+			  pending_targets[vertex] = false;
+			  --remaining;
+			}
+			return remaining > 0;
+		  });
+	  /// the targets are settled, or all reachable vertices are
+	  for (const VertexId to : targets) {
+		if (search_.reached[to]) {
+		  result.push_back(search_.weights[to]);
+		} else {
+		  result.emplace_back();
+		}
+	  }
+	}
+	return result;
+  }
+
+}  // namespace graph
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+  /// Number of workers for a "threads" setting: 0 means all hardware threads.
+  inline size_t ResolveThreadCount(size_t requested) {
+	if (requested != 0) {
+	  return requested;
+	}
+	return std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+
+  /// Calls func(index) for every index in [0, count) on up to thread_count
+  /// threads; indices are handed out one by one, the calling thread works too.
+  /// func must not throw.
+  template <typename Func>
+  void ForEachIndex(size_t count, size_t thread_count, const Func& func) {
+	thread_count = std::min(thread_count, count);
+	if (thread_count <= 1) {
+	  for (size_t index = 0; index < count; ++index) {
+		func(index);
+	  }
+	  return;
+	}
+	std::atomic<size_t> next_index {0};
+	auto worker = [&next_index, count, &func]() {
+	  for (size_t index = next_index++; index < count; index = next_index++) {
+		func(index);
+	  }
+	};
+	std::vector<std::thread> threads;
+	threads.reserve(thread_count - 1);
+	for (size_t i = 1; i < thread_count; ++i) {
+	  threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+	  thread.join();
+	}
+  }
+
+  /// Workers started once and reused for every ForEachIndex call, for the
+  /// builds that split into many short phases. The calling thread works too,
+  /// so thread_count - 1 threads are started. func must not throw.
+  class WorkerPool {
+  public:
+	explicit WorkerPool(size_t thread_count);
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	size_t GetThreadCount() const {
+	  return threads_.size() + 1;
+	}
+
+	/// Calls func(index) for every index in [0, count) and returns when all
+	/// the calls are done.
+	template <typename Func>
+	void ForEachIndex(size_t count, const Func& func);
+
+  private:
+	void Work();
+	void RunJob();
+
+	std::mutex mutex_;
+	std::condition_variable job_ready_;
+	std::condition_variable job_done_;
+	std::function<void(size_t)> job_;
+	size_t job_count_ = 0;
+	std::atomic<size_t> next_index_ {0};
+	size_t generation_ = 0;	 /// number of the jobs handed out
+	size_t busy_count_ = 0;	 /// workers yet to finish the current job
+	bool stopping_ = false;
+	std::vector<std::thread> threads_;
+  };
+
+  inline WorkerPool::WorkerPool(size_t thread_count) {
+	thread_count = std::max<size_t>(thread_count, 1);
+	threads_.reserve(thread_count - 1);
+	for (size_t i = 1; i < thread_count; ++i) {
+	  threads_.emplace_back([this]() {
+		Work();
+	  });
+	}
+  }
+
+  inline WorkerPool::~WorkerPool() {
+	{
+	  std::lock_guard lock(mutex_);
+	  stopping_ = true;
+	}
+	job_ready_.notify_all();
+	for (auto& thread : threads_) {
+	  thread.join();
+	}
+  }
+
+  template <typename Func>
+  void WorkerPool::ForEachIndex(size_t count, const Func& func) {
+	if (threads_.empty() || count <= 1) {
+	  for (size_t index = 0; index < count; ++index) {
+		func(index);
+	  }
+	  return;
+	}
+	{
+	  std::lock_guard lock(mutex_);
+	  job_ = [&func](size_t index) {
+		func(index);
+	  };
+	  job_count_ = count;
+	  next_index_ = 0;
+	  busy_count_ = threads_.size();
+	  ++generation_;
+	}
+	job_ready_.notify_all();
+	RunJob();
+	std::unique_lock lock(mutex_);
+	job_done_.wait(lock, [this]() {
+	  return busy_count_ == 0;
+	});
+	job_ = nullptr;
+  }
+
+  /// Every worker takes part in every job, so the next one is handed out only
+  /// after all of them have left the current one.
+  inline void WorkerPool::Work() {
+	size_t done_generation = 0;
+	std::unique_lock lock(mutex_);
+	while (true) {
+	  job_ready_.wait(lock, [this, done_generation]() {
+		return stopping_ || generation_ != done_generation;
+	  });
+	  if (stopping_) {
+		return;
+	  }
+	  done_generation = generation_;
+	  lock.unlock();
+	  RunJob();
+	  lock.lock();
+	  if (--busy_count_ == 0) {
+		job_done_.notify_one();
+	  }
+	}
+  }
+
+  inline void WorkerPool::RunJob() {
+	for (size_t index = next_index_++; index < job_count_; index = next_index_++) {
+	  job_(index);
+	}
+  }
+
+}  // namespace parallel
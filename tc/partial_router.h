@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "min_plus.h"
+#include "parallel.h"
+#include "router.h"
+#include "search_space.h"
+
+namespace graph {
+
+  /// Router that keeps full shortest-path trees only for the hot sources chosen
+  /// at make_base and searches the graph on demand from every other source.
+  /// A source searched promote_after times gets its tree built and kept too.
+  /// Unlike the other routers it may be shared between threads: trees are
+  /// immutable once built, and every on-demand search takes a search space of
+  /// its own from a free list of the router. The list keeps as many spaces as
+  /// there were searches at the same time, they live as long as the router.
+  template <typename Weight>
+  class PartialRouter {
+  private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+  public:
+	using RouteInfo = graph::RouteInfo<Weight>;
+
+	static constexpr Weight NO_ROUTE = min_plus::NoRoute<Weight>();
+	static constexpr CompactEdgeId NO_EDGE = min_plus::NO_EDGE;
+
+	/// Routes from the source to every vertex, prev_edges lead back to the source.
+	struct SourceTree {
+	  VertexId source;
+	  std::vector<Weight> weights;
+	  std::vector<CompactEdgeId> prev_edges;
+	};
+
+	/// promote_after 0 never builds trees at query time.
+	PartialRouter(const Graph& graph, const std::vector<VertexId>& sources,
+				  size_t promote_after = 0, size_t thread_count = 1);
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	/// Weights from every source to every target, row-major by source,
+	/// std::nullopt where there is no route.
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+													const std::vector<VertexId>& targets) const;
+	/// Vertices reachable from the vertex with weight at most max_weight.
+	std::vector<std::pair<VertexId, Weight>> BuildWeightsWithin(VertexId from,
+																Weight max_weight) const;
+
+	/// Sources with a tree, the promoted ones included, in increasing order.
+	std::vector<VertexId> GetSources() const;
+	std::vector<std::shared_ptr<const SourceTree>> GetTrees() const;
+	void AddTree(SourceTree tree);
+
+  private:
+	using SearchSpace = graph::SearchSpace<Weight, CompactEdgeId>;
+	using QueueItem = typename SearchSpace::QueueItem;
+
+	/// The tree of the source if it is kept or gets promoted by this search, nullptr otherwise.
+	std::shared_ptr<const SourceTree> FindTree(VertexId from) const;
+	/// A search space off the free list, a new one if the list is empty.
+	std::unique_ptr<SearchSpace> AcquireSearchSpace() const;
+	void ReleaseSearchSpace(std::unique_ptr<SearchSpace> search) const;
+	/// Dijkstra search from the vertex. Stops once to is settled unless it is
+	/// NO_VERTEX; routes heavier than max_weight are not followed.
+	void Search(SearchSpace& search, VertexId from, VertexId to = NO_VERTEX,
+				Weight max_weight = NO_ROUTE) const;
+	static Weight GetWeight(const SearchSpace& search, VertexId vertex) {
+	  return search.reached[vertex] ? search.weights[vertex] : NO_ROUTE;
+	}
+	/// Full tree of the source, for the kept ones only.
+	SourceTree SearchTree(VertexId from) const;
+	void CheckVertex(VertexId vertex) const;
+
+	static constexpr Weight ZERO_WEIGHT {};
+	static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+
+	const Graph& graph_;
+	const size_t promote_after_;
+
+	mutable std::shared_mutex trees_mutex_;
+	mutable std::unordered_map<VertexId, std::shared_ptr<const SourceTree>> trees_;
+	mutable std::mutex search_counts_mutex_;
+	mutable std::unordered_map<VertexId, size_t> search_counts_;
+	mutable std::mutex search_spaces_mutex_;
+	mutable std::vector<std::unique_ptr<SearchSpace>> search_spaces_;
+  };
+
+  template <typename Weight>
+  PartialRouter<Weight>::PartialRouter(const Graph& graph, const std::vector<VertexId>& sources,
+									   size_t promote_after, size_t thread_count)
+	  : graph_(graph), promote_after_(promote_after) {
+	if (graph.GetEdgeCount() >= NO_EDGE) {
+	  throw std::length_error("Too many edges for the source trees");
+	}
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+	  if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	}
+	std::vector<VertexId> unique_sources = sources;
+	std::sort(unique_sources.begin(), unique_sources.end());
+	unique_sources.erase(std::unique(unique_sources.begin(), unique_sources.end()),
+						 unique_sources.end());
+	for (const VertexId source : unique_sources) {
+	  CheckVertex(source);
+	}
+
+	std::vector<SourceTree> trees(unique_sources.size());
+	parallel::ForEachIndex(trees.size(), thread_count, [this, &trees, &unique_sources](size_t i) {
+	  trees[i] = SearchTree(unique_sources[i]);
+	});
+	for (SourceTree& tree : trees) {
+	  AddTree(std::move(tree));
+	}
+	/// the spaces of the build threads are not needed by the queries
+	search_spaces_.clear();
+  }
+
+  template <typename Weight>
+  void PartialRouter<Weight>::CheckVertex(VertexId vertex) const {
+	if (vertex >= graph_.GetVertexCount()) {
+	  throw std::out_of_range("Vertex is out of graph");
+	}
+  }
+
+  template <typename Weight>
+  std::shared_ptr<const typename PartialRouter<Weight>::SourceTree>
+  PartialRouter<Weight>::FindTree(VertexId from) const {
+	{
+	  std::shared_lock lock(trees_mutex_);
+	  if (const auto it = trees_.find(from); it != trees_.end()) {
+		return it->second;
+	  }
+	}
+	if (promote_after_ == 0) {
+	  return nullptr;
+	}
+	{
+	  std::lock_guard lock(search_counts_mutex_);
+	  if (++search_counts_[from] < promote_after_) {
+		return nullptr;
+	  }
+	  search_counts_.erase(from);
+	}
+	auto tree = std::make_shared<const SourceTree>(SearchTree(from));
+	std::unique_lock lock(trees_mutex_);
+	return trees_.emplace(from, std::move(tree)).first->second;
+  }
+
+  template <typename Weight>
+  std::unique_ptr<typename PartialRouter<Weight>::SearchSpace>
+  PartialRouter<Weight>::AcquireSearchSpace() const {
+	{
+	  std::lock_guard lock(search_spaces_mutex_);
+	  if (!search_spaces_.empty()) {
+		std::unique_ptr<SearchSpace> search = std::move(search_spaces_.back());
+		search_spaces_.pop_back();
+		return search;
+	  }
+	}
+	return std::make_unique<SearchSpace>();
+  }
+
+  template <typename Weight>
+  void PartialRouter<Weight>::ReleaseSearchSpace(std::unique_ptr<SearchSpace> search) const {
+	std::lock_guard lock(search_spaces_mutex_);
+	search_spaces_.push_back(std::move(search));
+  }
+
+  template <typename Weight>
+  void PartialRouter<Weight>::Search(SearchSpace& search, VertexId from, VertexId to,
+									 Weight max_weight) const {
+	search.Prepare(graph_.GetVertexCount());
+	search.Reset();
+	search.Reach(from, ZERO_WEIGHT, NO_EDGE);
+	while (!search.heap.empty()) {
+	  const QueueItem item = search.Pop();
+	  if (item.weight > search.weights[item.vertex]) {
+		continue;
+	  }
+	  if (item.vertex == to) {
+		break;
+	  }
+	  for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+		const auto& edge = graph_.GetEdge(edge_id);
+		const Weight candidate_weight = item.weight + edge.weight;
+		if (!(max_weight < candidate_weight)
+			&& search.IsImprovedBy(edge.to, candidate_weight)) {
+		  search.Reach(edge.to, candidate_weight, static_cast<CompactEdgeId>(edge_id));
+		}
+	  }
+	}
+  }
+
+  template <typename Weight>
+  typename PartialRouter<Weight>::SourceTree PartialRouter<Weight>::SearchTree(
+	  VertexId from) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	SourceTree tree {from, std::vector<Weight>(vertex_count, NO_ROUTE),
+					 std::vector<CompactEdgeId>(vertex_count, NO_EDGE)};
+	std::unique_ptr<SearchSpace> search = AcquireSearchSpace();
+	Search(*search, from);
+	for (const VertexId vertex : search->touched) {
+	  tree.weights[vertex] = search->weights[vertex];
+	  tree.prev_edges[vertex] = search->prevs[vertex];
+	}
+	ReleaseSearchSpace(std::move(search));
+	return tree;
+  }
+
+  template <typename Weight>
+  std::optional<typename PartialRouter<Weight>::RouteInfo> PartialRouter<Weight>::BuildRoute(
+	  VertexId from, VertexId to) const {
+	CheckVertex(from);
+	CheckVertex(to);
+	auto build_route = [this, to](Weight weight, const std::vector<CompactEdgeId>& prev_edges) {
+	  std::vector<EdgeId> edges;
+	  for (CompactEdgeId edge_id = prev_edges[to]; edge_id != NO_EDGE;
+		   edge_id = prev_edges[graph_.GetEdge(edge_id).from]) {
+		edges.push_back(edge_id);
+	  }
+	  std::reverse(edges.begin(), edges.end());
+	  return RouteInfo {weight, std::move(edges)};
+	};
+	if (const std::shared_ptr<const SourceTree> tree = FindTree(from)) {
+	  if (tree->weights[to] == NO_ROUTE) {
+		return std::nullopt;
+	  }
+	  return build_route(tree->weights[to], tree->prev_edges);
+	}
+	std::unique_ptr<SearchSpace> search = AcquireSearchSpace();
+	Search(*search, from, to);
+	std::optional<RouteInfo> route;
+	if (search->reached[to]) {
+	  route = build_route(search->weights[to], search->prevs);
+	}
+	ReleaseSearchSpace(std::move(search));
+	return route;
+  }
+
+  template <typename Weight>
+  std::vector<std::optional<Weight>> PartialRouter<Weight>::BuildWeights(
+	  const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+	for (const VertexId vertex : targets) {
+	  CheckVertex(vertex);
+	}
+	std::vector<std::optional<Weight>> result;
+	result.reserve(sources.size() * targets.size());
+	std::unique_ptr<SearchSpace> search;
+	for (const VertexId source : sources) {
+	  CheckVertex(source);
+	  const std::shared_ptr<const SourceTree> tree = FindTree(source);
+	  if (!tree) {
+		if (!search) {
+		  search = AcquireSearchSpace();
+		}
+		Search(*search, source);
+	  }
+	  for (const VertexId target : targets) {
+		const Weight weight = tree ? tree->weights[target] : GetWeight(*search, target);
+		if (weight == NO_ROUTE) {
+		  result.emplace_back();
+		} else {
+		  result.emplace_back(weight);
+		}
+	  }
+	}
+	if (search) {
+	  ReleaseSearchSpace(std::move(search));
+	}
+	return result;
+  }
+
+  template <typename Weight>
+  std::vector<std::pair<VertexId, Weight>> PartialRouter<Weight>::BuildWeightsWithin(
+	  VertexId from, Weight max_weight) const {
+	CheckVertex(from);
+	std::vector<std::pair<VertexId, Weight>> result;
+	if (const std::shared_ptr<const SourceTree> tree = FindTree(from)) {
+	  for (VertexId vertex = 0; vertex < tree->weights.size(); ++vertex) {
+		if (tree->weights[vertex] != NO_ROUTE && !(max_weight < tree->weights[vertex])) {
+		  result.emplace_back(vertex, tree->weights[vertex]);
+		}
+	  }
+	  return result;
+	}
+	/// the search follows no route heavier than max_weight
+	std::unique_ptr<SearchSpace> search = AcquireSearchSpace();
+	Search(*search, from, NO_VERTEX, max_weight);
+	result.reserve(search->touched.size());
+	for (const VertexId vertex : search->touched) {
+	  result.emplace_back(vertex, search->weights[vertex]);
+	}
+	ReleaseSearchSpace(std::move(search));
+	std::sort(result.begin(), result.end());
+	return result;
+  }
+
+  template <typename Weight>
+  std::vector<VertexId> PartialRouter<Weight>::GetSources() const {
+	std::vector<VertexId> sources;
+	{
+	  std::shared_lock lock(trees_mutex_);
+	  sources.reserve(trees_.size());
+	  for (const auto& [source, tree] : trees_) {
+		sources.push_back(source);
+	  }
+	}
+	std::sort(sources.begin(), sources.end());
+	return sources;
+  }
+
+  template <typename Weight>
+  std::vector<std::shared_ptr<const typename PartialRouter<Weight>::SourceTree>>
+  PartialRouter<Weight>::GetTrees() const {
+	std::vector<std::shared_ptr<const SourceTree>> trees;
+	{
+	  std::shared_lock lock(trees_mutex_);
+	  trees.reserve(trees_.size());
+	  for (const auto& [source, tree] : trees_) {
+		trees.push_back(tree);
+	  }
+	}
+	std::sort(trees.begin(), trees.end(), [](const auto& lhs, const auto& rhs) {
+	  return lhs->source < rhs->source;
+	});
+	return trees;
+  }
+
+  template <typename Weight>
+  void PartialRouter<Weight>::AddTree(SourceTree tree) {
+	const VertexId source = tree.source;
+	auto stored_tree = std::make_shared<const SourceTree>(std::move(tree));
+	std::unique_lock lock(trees_mutex_);
+	trees_[source] = std::move(stored_tree);
+  }
+
+}  // namespace graph
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+  /// Monotone priority queue for unsigned integer keys: a pushed key must not
+  /// be less than the last popped one, which holds for Dijkstra searches (and
+  /// A* with a consistent bound). Items sit in buckets by the highest bit where
+  /// their key differs from the last popped one; a pop only redistributes the
+  /// first non-empty bucket, so every item moves at most once per key bit.
+  template <typename Key, typename Value>
+  class RadixHeap {
+	static_assert(std::is_unsigned_v<Key> && std::numeric_limits<Key>::digits <= 64,
+				  "Radix heap keys should be unsigned, at most 64 bits");
+
+  public:
+	using Item = std::pair<Key, Value>;
+
+	bool IsEmpty() const {
+	  return size_ == 0;
+	}
+
+	size_t GetSize() const {
+	  return size_;
+	}
+
+	void Push(Key key, Value value) {
+	  if (key < last_key_) {
+		throw std::logic_error("Radix heap keys should not decrease");
+	  }
+	  buckets_[GetBucket(key)].emplace_back(key, std::move(value));
+	  ++size_;
+	}
+
+	/// Item with the least key, in no particular order among equal keys.
+	Item Pop() {
+	  if (size_ == 0) {
+		throw std::out_of_range("Radix heap is empty");
+	  }
+	  if (buckets_[0].empty()) {
+		size_t bucket = 1;
+		while (buckets_[bucket].empty()) {
+		  ++bucket;
+		}
+		std::vector<Item>& items = buckets_[bucket];
+		last_key_ = std::min_element(items.begin(), items.end(),
+									 [](const Item& lhs, const Item& rhs) {
+									   return lhs.first < rhs.first;
+									 })
+						->first;
+		for (Item& item : items) {
+		  buckets_[GetBucket(item.first)].push_back(std::move(item));
+		}
+		items.clear();
+	  }
+	  Item item = std::move(buckets_[0].back());
+	  buckets_[0].pop_back();
+	  --size_;
+	  return item;
+	}
+
+	/// Empties the heap and accepts any key again; the buckets keep their memory.
+	void Clear() {
+	  for (std::vector<Item>& bucket : buckets_) {
+		bucket.clear();
+	  }
+	  size_ = 0;
+	  last_key_ = 0;
+	}
+
+  private:
+	static constexpr size_t KEY_BITS = std::numeric_limits<Key>::digits;
+
+	/// Bit width of the difference from the last popped key.
+	size_t GetBucket(Key key) const {
+	  unsigned long long difference = key ^ last_key_;
+#if defined(__GNUC__) || defined(__clang__)
+	  return difference == 0
+				 ? 0
+				 : std::numeric_limits<unsigned long long>::digits - __builtin_clzll(difference);
+#else
+	  size_t bucket = 0;
+	  for (; difference != 0; difference >>= 1) {
+		++bucket;
+	  }
+	  return bucket;
+#endif
+	}
+
+	std::array<std::vector<Item>, KEY_BITS + 1> buckets_;
+	size_t size_ = 0;
+	Key last_key_ = 0;
+  };
+
+}  // namespace graph
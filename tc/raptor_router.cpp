@@ -0,0 +1,206 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace transport_router {
+  using namespace transport;
+
+  RaptorRouter::RaptorRouter(const TransportCatalogue& catalogue, double bus_wait_time,
+							 double bus_velocity)
+	  : bus_wait_time_(bus_wait_time), bus_velocity_(bus_velocity) {
+	for (const auto& [name, stop] : catalogue.GetStopsForRender()) {
+	  stop_ids_[name] = static_cast<StopId>(stop_names_.size());
+	  stop_names_.push_back(name);
+	}
+	for (const auto& [name, bus] : catalogue.GetRoutesForRender()) {
+	  const std::vector<std::string_view>& stops = bus.stops;
+	  if (bus.is_round_trip) {
+		AddLine(catalogue, name, stops.begin(), stops.end());
+	  } else if (!stops.empty()) {
+		/// stops are stored there and back, the bus turns at the end stop in the middle
+		const auto end_stop = stops.begin() + stops.size() / 2;
+		AddLine(catalogue, name, stops.begin(), end_stop + 1);
+		AddLine(catalogue, name, end_stop, stops.end());
+	  }
+	}
+
+	stop_offsets_.assign(stop_names_.size() + 1, 0);
+	for (const StopId stop : line_stops_) {
+	  ++stop_offsets_[stop + 1];
+	}
+	std::partial_sum(stop_offsets_.begin(), stop_offsets_.end(), stop_offsets_.begin());
+	stop_lines_.resize(line_stops_.size());
+	std::vector<size_t> next_position(stop_offsets_.begin(), prev(stop_offsets_.end()));
+	for (uint32_t line_id = 0; line_id < lines_.size(); ++line_id) {
+	  const Line& line = lines_[line_id];
+	  for (uint32_t position = 0; position < line.size; ++position) {
+		const StopId stop = line_stops_[line.first + position];
+		stop_lines_[next_position[stop]++] = {line_id, position};
+	  }
+	}
+  }
+
+  void RaptorRouter::AddLine(const TransportCatalogue& catalogue, std::string_view bus,
+							 std::vector<std::string_view>::const_iterator begin,
+							 std::vector<std::string_view>::const_iterator end) {
+	if (end - begin < 2) {
+	  return;
+	}
+	const TransportCatalogue::DistMap& distances = catalogue.GetDistForRouter();
+	lines_.push_back({bus, line_stops_.size(), static_cast<size_t>(end - begin)});
+	int distance = 0;
+	for (auto it = begin; it != end; ++it) {
+	  if (it != begin) {
+		const auto forward = distances.find(std::pair(*prev(it), *it));
+		distance += forward != distances.end() ? forward->second
+											   : distances.at(std::pair(*it, *prev(it)));
+	  }
+	  line_stops_.push_back(stop_ids_.at(*it));
+	  line_distances_.push_back(distance);
+	}
+  }
+
+  double RaptorRouter::RideTime(const Line& line, uint32_t board, uint32_t alight) const {
+	return (line_distances_[line.first + alight] - line_distances_[line.first + board])
+		   / bus_velocity_;
+  }
+
+  void RaptorRouter::Improve(StopId stop, const Label& label) const {
+	if (labels_[stop].weight == NO_ROUTE) {
+	  touched_.push_back(stop);
+	}
+	labels_[stop] = label;
+	if (!marked_[stop]) {
+	  marked_[stop] = true;
+	  marked_stops_.push_back(stop);
+	}
+  }
+
+  /// Rides from the boarding stop with the least weight - distance / velocity,
+  /// which is the best one for every later stop of the line.
+  void RaptorRouter::ScanLine(uint32_t line_id, StopId to, double max_weight) const {
+	const Line& line = lines_[line_id];
+	const StopId* stops = line_stops_.data() + line.first;
+	uint32_t board = NO_POSITION;
+	double board_key = NO_ROUTE;
+	for (uint32_t position = line_first_[line_id]; position < line.size; ++position) {
+	  const StopId stop = stops[position];
+	  if (board != NO_POSITION) {
+		const double weight = labels_[stops[board]].weight + bus_wait_time_
+							  + RideTime(line, board, position);
+		if (weight < labels_[stop].weight && !(max_weight < weight)
+			&& (to == NO_STOP || weight < labels_[to].weight)) {
+		  Improve(stop, {weight, line_id, board, position});
+		}
+	  }
+	  const double weight = labels_[stop].weight;
+	  if (weight != NO_ROUTE) {
+		const double key = weight - line_distances_[line.first + position] / bus_velocity_;
+		if (key < board_key) {
+		  board = position;
+		  board_key = key;
+		}
+	  }
+	}
+  }
+
+  void RaptorRouter::ResetScratch() const {
+	for (const StopId stop : touched_) {
+	  labels_[stop] = Label {};
+	}
+	touched_.clear();
+  }
+
+  void RaptorRouter::RunRounds(StopId from, StopId to, double max_weight) const {
+	if (labels_.size() != stop_names_.size()) {
+	  labels_.assign(stop_names_.size(), Label {});
+	  marked_.assign(stop_names_.size(), false);
+	  line_first_.assign(lines_.size(), NO_POSITION);
+	}
+
+	Improve(from, {0.0, NO_LINE, 0, 0});
+	while (!marked_stops_.empty()) {
+	  for (const StopId stop : marked_stops_) {
+		marked_[stop] = false;
+		for (size_t i = stop_offsets_[stop]; i < stop_offsets_[stop + 1]; ++i) {
+		  const LineStop& line_stop = stop_lines_[i];
+		  uint32_t& first = line_first_[line_stop.line];
+		  if (first == NO_POSITION) {
+			queued_lines_.push_back(line_stop.line);
+		  }
+		  first = std::min(first, line_stop.position);
+		}
+	  }
+	  marked_stops_.clear();
+	  for (const uint32_t line_id : queued_lines_) {
+		ScanLine(line_id, to, max_weight);
+		line_first_[line_id] = NO_POSITION;
+	  }
+	  queued_lines_.clear();
+	}
+  }
+
+  std::optional<RaptorRouter::RouteInfo> RaptorRouter::BuildRoute(std::string_view from,
+																  std::string_view to) const {
+	const StopId from_id = stop_ids_.at(from);
+	const StopId to_id = stop_ids_.at(to);
+	RunRounds(from_id, to_id);
+
+	if (labels_[to_id].weight == NO_ROUTE) {
+	  ResetScratch();
+	  return std::nullopt;
+	}
+	RouteInfo route {labels_[to_id].weight, {}};
+	for (StopId stop = to_id; labels_[stop].line != NO_LINE;) {
+	  const Label& label = labels_[stop];
+	  const Line& line = lines_[label.line];
+	  const StopId board_stop = line_stops_[line.first + label.board];
+	  route.rides.push_back({stop_names_[board_stop], line.bus,
+							 RideTime(line, label.board, label.alight),
+							 static_cast<size_t>(label.alight - label.board)});
+	  stop = board_stop;
+	}
+	std::reverse(route.rides.begin(), route.rides.end());
+	ResetScratch();
+
+	return route;
+  }
+
+  std::vector<std::optional<double>> RaptorRouter::BuildWeights(
+	  const std::vector<std::string_view>& sources,
+	  const std::vector<std::string_view>& targets) const {
+	std::vector<StopId> target_ids;
+	target_ids.reserve(targets.size());
+	for (const std::string_view target : targets) {
+	  target_ids.push_back(stop_ids_.at(target));
+	}
+	std::vector<std::optional<double>> result;
+	result.reserve(sources.size() * targets.size());
+	for (const std::string_view source : sources) {
+	  RunRounds(stop_ids_.at(source), NO_STOP);
+	  for (const StopId target : target_ids) {
+		if (labels_[target].weight == NO_ROUTE) {
+		  result.emplace_back();
+		} else {
+		  result.emplace_back(labels_[target].weight);
+		}
+	  }
+	  ResetScratch();
+	}
+	return result;
+  }
+
+  std::vector<std::pair<std::string_view, double>> RaptorRouter::BuildWeightsWithin(
+	  std::string_view from, double max_weight) const {
+	RunRounds(stop_ids_.at(from), NO_STOP, max_weight);
+	std::vector<std::pair<std::string_view, double>> result;
+	result.reserve(touched_.size());
+	for (const StopId stop : touched_) {
+	  result.emplace_back(stop_names_[stop], labels_[stop].weight);
+	}
+	ResetScratch();
+	return result;
+  }
+
+}  // namespace transport_router
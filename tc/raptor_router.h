@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "transport_catalogue.h"
+
+namespace transport_router {
+
+  /// Round-based router over the bus lines themselves (RAPTOR without a
+  /// timetable): every round scans the lines serving the stops improved in the
+  /// previous round, boarding costs the wait time and riding from stop i to
+  /// stop j costs the distance between them divided by the velocity. Only the
+  /// stop sequences and prefix distances of the lines are kept, nothing is
+  /// precomputed, a query is O(rounds * total line length).
+  /// Scratch buffers are reused between queries, so a router instance must not
+  /// be shared between threads.
+  class RaptorRouter {
+  public:
+	using StopId = uint32_t;
+
+	struct Ride {
+	  std::string_view stop;  /// boarding stop, the wait happens here
+	  std::string_view bus;
+	  double time;
+	  size_t span_count;
+	};
+
+	struct RouteInfo {
+	  double weight;
+	  std::vector<Ride> rides;
+	};
+
+	/// bus_velocity is in meters per minute.
+	RaptorRouter(const transport::TransportCatalogue& catalogue, double bus_wait_time,
+				 double bus_velocity);
+
+	std::optional<RouteInfo> BuildRoute(std::string_view from, std::string_view to) const;
+	double GetBusWaitTime() const {
+	  return bus_wait_time_;
+	}
+	StopId GetStopId(std::string_view stop) const {
+	  return stop_ids_.at(stop);
+	}
+	/// One-to-all rounds per source. Row-major by source, std::nullopt where
+	/// there is no route.
+	std::vector<std::optional<double>> BuildWeights(
+		const std::vector<std::string_view>& sources,
+		const std::vector<std::string_view>& targets) const;
+	/// Stops reachable from the stop with weight at most max_weight; rides
+	/// beyond it are not taken.
+	std::vector<std::pair<std::string_view, double>> BuildWeightsWithin(
+		std::string_view from, double max_weight) const;
+
+  private:
+	/// Part of a bus that is ridden without leaving it: the whole round trip,
+	/// or one direction of a non-round trip.
+	struct Line {
+	  std::string_view bus;
+	  size_t first;	 /// offset in line_stops_ and line_distances_
+	  size_t size;
+	};
+
+	struct LineStop {
+	  uint32_t line;
+	  uint32_t position;
+	};
+
+	struct Label {
+	  double weight = NO_ROUTE;
+	  uint32_t line = NO_LINE;
+	  uint32_t board = 0;
+	  uint32_t alight = 0;
+	};
+
+	void AddLine(const transport::TransportCatalogue& catalogue, std::string_view bus,
+				 std::vector<std::string_view>::const_iterator begin,
+				 std::vector<std::string_view>::const_iterator end);
+	double RideTime(const Line& line, uint32_t board, uint32_t alight) const;
+	void Improve(StopId stop, const Label& label) const;
+	/// Runs the rounds from the stop, pruned by max_weight and by the weight of
+	/// to unless it is NO_STOP.
+	void RunRounds(StopId from, StopId to, double max_weight = NO_ROUTE) const;
+	void ScanLine(uint32_t line_id, StopId to, double max_weight) const;
+	void ResetScratch() const;
+
+	static constexpr double NO_ROUTE = std::numeric_limits<double>::infinity();
+	static constexpr uint32_t NO_LINE = std::numeric_limits<uint32_t>::max();
+	static constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+	static constexpr StopId NO_STOP = std::numeric_limits<StopId>::max();
+
+	double bus_wait_time_;
+	double bus_velocity_;
+
+	std::vector<std::string_view> stop_names_;
+	std::unordered_map<std::string_view, StopId> stop_ids_;
+
+	std::vector<Line> lines_;
+	std::vector<StopId> line_stops_;
+	std::vector<int> line_distances_;  /// from the first stop of the line
+
+	/// Positions of every stop on the lines, grouped by stop.
+	std::vector<size_t> stop_offsets_;
+	std::vector<LineStop> stop_lines_;
+
+	mutable std::vector<Label> labels_;
+	mutable std::vector<StopId> touched_;
+	mutable std::vector<bool> marked_;
+	mutable std::vector<StopId> marked_stops_;
+	mutable std::vector<uint32_t> line_first_;	/// first position to scan, per line
+	mutable std::vector<uint32_t> queued_lines_;
+  };
+
+}  // namespace transport_router
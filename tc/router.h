@@ -3,7 +3,9 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -11,29 +13,72 @@
 #include <vector>
 
 #include "graph.h"
+#include "min_plus.h"
+#include "parallel.h"
 
 namespace graph {
 
   template <typename Weight>
+  struct RouteInfo {
+	Weight weight;
+	std::vector<EdgeId> edges;
+  };
+
+  /// Row-major vertex_count x vertex_count table of shortest routes kept as two
+  /// parallel arrays. Missing routes and missing previous edges are sentinels.
+  template <typename StoredWeight>
+  struct RoutesTable {
+	static constexpr StoredWeight NO_ROUTE = min_plus::NoRoute<StoredWeight>();
+	static constexpr CompactEdgeId NO_EDGE = min_plus::NO_EDGE;
+
+	size_t vertex_count = 0;
+	std::vector<StoredWeight> weights;
+	std::vector<CompactEdgeId> prev_edges;
+
+	void Reset(size_t new_vertex_count) {
+	  vertex_count = new_vertex_count;
+	  weights.assign(vertex_count * vertex_count, NO_ROUTE);
+	  prev_edges.assign(vertex_count * vertex_count, NO_EDGE);
+	}
+
+	size_t Index(VertexId from, VertexId to) const {
+	  return from * vertex_count + to;
+	}
+  };
+
+  /// All-pairs router. StoredWeight may be narrower than Weight (e.g. float for
+  /// double graphs) to halve the table at the cost of precision.
+  template <typename Weight, typename StoredWeight = Weight>
   class Router {
   private:
 	using Graph = DirectedWeightedGraph<Weight>;
 
   public:
-	explicit Router(const Graph& graph);
+	explicit Router(const Graph& graph, size_t thread_count = 1);
 
-	struct RouteInfo {
-	  Weight weight;
-	  std::vector<EdgeId> edges;
-	};
-
-	struct RouteInternalData {
-	  Weight weight;
-	  std::optional<EdgeId> prev_edge;
-	};
-	using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+	using RouteInfo = graph::RouteInfo<Weight>;
+	using RoutesInternalData = RoutesTable<StoredWeight>;
 
 	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	/// Weights from every source to every target, row-major by source,
+	/// std::nullopt where there is no route.
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+													const std::vector<VertexId>& targets) const;
+	/// Vertices reachable from the vertex with weight at most max_weight.
+	std::vector<std::pair<VertexId, Weight>> BuildWeightsWithin(VertexId from,
+																Weight max_weight) const;
+
+	/// Incremental updates after the graph has changed: the table is repaired
+	/// instead of being rebuilt.
+	/// Adds vertices up to vertex_count, with no routes but to themselves.
+	void AddVertices(size_t vertex_count);
+	/// Follows the new edge ids after the graph is frozen again.
+	void RenumberEdges(const std::vector<EdgeId>& new_ids);
+	/// Rows whose routes go through an edge that got heavier are searched
+	/// again; new and lighter edges are relaxed in, then the table is relaxed
+	/// through their ends only, O(ends * vertex_count^2).
+	void UpdateEdges(const std::vector<EdgeId>& increased_edges,
+					 const std::vector<EdgeId>& decreased_edges);
 
 	RoutesInternalData& ModifyRoutesInternalData() {
 	  return routes_internal_data_;
@@ -46,82 +91,342 @@ namespace graph {
   private:
 	void InitializeRoutesInternalData(const Graph& graph) {
 	  const size_t vertex_count = graph.GetVertexCount();
+	  if (graph.GetEdgeCount() >= RoutesInternalData::NO_EDGE) {
+		throw std::length_error("Too many edges for the routes table");
+	  }
+	  routes_internal_data_.Reset(vertex_count);
 	  for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-		routes_internal_data_[vertex][vertex]
-			= RouteInternalData {ZERO_WEIGHT, std::nullopt};
+		routes_internal_data_.weights[routes_internal_data_.Index(vertex, vertex)]
+			= ZERO_WEIGHT;
 		for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
 		  const auto& edge = graph.GetEdge(edge_id);
-		  if (edge.weight < ZERO_WEIGHT) {
+		  if (edge.weight < Weight {}) {
 			throw std::domain_error("Edges' weights should be non-negative");
 		  }
-		  auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-		  if (!route_internal_data || route_internal_data->weight > edge.weight) {
-			route_internal_data = RouteInternalData {edge.weight, edge_id};
+		  const size_t index = routes_internal_data_.Index(vertex, edge.to);
+		  const StoredWeight weight = static_cast<StoredWeight>(edge.weight);
+		  if (routes_internal_data_.weights[index] > weight) {
+			routes_internal_data_.weights[index] = weight;
+			routes_internal_data_.prev_edges[index] = static_cast<CompactEdgeId>(edge_id);
 		  }
 		}
 	  }
 	}
 
-	void RelaxRoute(VertexId vertex_from, VertexId vertex_to,
-					const RouteInternalData& route_from,
-					const RouteInternalData& route_to) {
-	  auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-	  const Weight candidate_weight = route_from.weight + route_to.weight;
-	  if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-		route_relaxing = {candidate_weight,
-						  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
-	  }
-	}
-
 	void RelaxRoutesInternalDataThroughVertex(size_t vertex_count,
 											  VertexId vertex_through) {
+	  StoredWeight* const weights = routes_internal_data_.weights.data();
+	  CompactEdgeId* const prev_edges = routes_internal_data_.prev_edges.data();
+	  const StoredWeight* const through_weights = weights + vertex_through * vertex_count;
+	  const CompactEdgeId* const through_prev_edges
+		  = prev_edges + vertex_through * vertex_count;
 	  for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-		if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-		  for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-			if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-			  RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-			}
-		  }
+		const size_t row = vertex_from * vertex_count;
+		const StoredWeight weight_from = weights[row + vertex_through];
+		if (weight_from == RoutesInternalData::NO_ROUTE) {
+		  continue;
 		}
+		min_plus::RelaxRow(weights + row, prev_edges + row, through_weights,
+						   through_prev_edges, vertex_count, weight_from,
+						   prev_edges[row + vertex_through]);
 	  }
 	}
 
-	static constexpr Weight ZERO_WEIGHT {};
+	void RelaxRoutesInternalDataBlocked(size_t vertex_count, size_t thread_count);
+	/// Dijkstra search of the row over the graph.
+	void RecomputeRoutesInternalDataRow(VertexId from);
+
+	static constexpr StoredWeight ZERO_WEIGHT {};
+	static constexpr size_t BLOCK_SIZE = 64;
 	const Graph& graph_;
 	RoutesInternalData routes_internal_data_;
   };
 
-  template <typename Weight>
-  Router<Weight>::Router(const Graph& graph)
-	  : graph_(graph),
-		routes_internal_data_(
-			graph.GetVertexCount(),
-			std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount())) {
+  template <typename Weight, typename StoredWeight>
+  Router<Weight, StoredWeight>::Router(const Graph& graph, size_t thread_count)
+	  : graph_(graph) {
 	InitializeRoutesInternalData(graph);
 
 	const size_t vertex_count = graph.GetVertexCount();
+	if (thread_count > 1 && vertex_count > BLOCK_SIZE) {
+	  RelaxRoutesInternalDataBlocked(vertex_count, thread_count);
+	  return;
+	}
 	for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
 	  RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
 	}
   }
 
-  template <typename Weight>
-  std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(
-	  VertexId from, VertexId to) const {
-	const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-	if (!route_internal_data) {
+  /// Tiled Floyd-Warshall. Each phase takes BLOCK_SIZE pivots and relaxes the
+  /// diagonal tile, then the tiles of its block row and column, then the rest,
+  /// the last two stages in parallel on workers started once for all phases.
+  /// Every tile applies the pivots in the same order as the serial loop,
+  /// reading the pivot row and column as they were at that pivot's step
+  /// (snapshotted by the tiles that own them), so the table is bit-identical
+  /// to the serial one.
+  template <typename Weight, typename StoredWeight>
+  void Router<Weight, StoredWeight>::RelaxRoutesInternalDataBlocked(size_t vertex_count,
+																	size_t thread_count) {
+	StoredWeight* const weights = routes_internal_data_.weights.data();
+	CompactEdgeId* const prev_edges = routes_internal_data_.prev_edges.data();
+	const size_t block_count = (vertex_count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	parallel::WorkerPool workers(thread_count);
+
+	std::vector<StoredWeight> pivot_row_weights(BLOCK_SIZE * vertex_count);
+	std::vector<CompactEdgeId> pivot_row_prev_edges(BLOCK_SIZE * vertex_count);
+	std::vector<StoredWeight> pivot_column_weights(BLOCK_SIZE * vertex_count);
+	std::vector<CompactEdgeId> pivot_column_prev_edges(BLOCK_SIZE * vertex_count);
+
+	auto relax_tile = [&](size_t block_through, size_t block_from, size_t block_to) {
+	  const size_t through_begin = block_through * BLOCK_SIZE;
+	  const size_t through_end = std::min(through_begin + BLOCK_SIZE, vertex_count);
+	  const size_t from_begin = block_from * BLOCK_SIZE;
+	  const size_t from_end = std::min(from_begin + BLOCK_SIZE, vertex_count);
+	  const size_t to_begin = block_to * BLOCK_SIZE;
+	  const size_t to_end = std::min(to_begin + BLOCK_SIZE, vertex_count);
+	  for (VertexId vertex_through = through_begin; vertex_through < through_end;
+		   ++vertex_through) {
+		const size_t step = (vertex_through - through_begin) * vertex_count;
+		if (block_from == block_through) {
+		  const size_t row = vertex_through * vertex_count;
+		  std::copy(weights + row + to_begin, weights + row + to_end,
+					pivot_row_weights.data() + step + to_begin);
+		  std::copy(prev_edges + row + to_begin, prev_edges + row + to_end,
+					pivot_row_prev_edges.data() + step + to_begin);
+		}
+		if (block_to == block_through) {
+		  for (VertexId vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+			const size_t index = vertex_from * vertex_count + vertex_through;
+			pivot_column_weights[step + vertex_from] = weights[index];
+			pivot_column_prev_edges[step + vertex_from] = prev_edges[index];
+		  }
+		}
+		for (VertexId vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+		  const StoredWeight weight_from = pivot_column_weights[step + vertex_from];
+		  if (weight_from == RoutesInternalData::NO_ROUTE) {
+			continue;
+		  }
+		  const size_t row = vertex_from * vertex_count;
+		  min_plus::RelaxRow(weights + row + to_begin, prev_edges + row + to_begin,
+							 pivot_row_weights.data() + step + to_begin,
+							 pivot_row_prev_edges.data() + step + to_begin,
+							 to_end - to_begin, weight_from,
+							 pivot_column_prev_edges[step + vertex_from]);
+		}
+	  }
+	};
+
+	const size_t side_count = block_count - 1;
+	for (size_t block_through = 0; block_through < block_count; ++block_through) {
+	  auto other_block = [block_through](size_t index) {
+		return index < block_through ? index : index + 1;
+	  };
+	  relax_tile(block_through, block_through, block_through);
+	  workers.ForEachIndex(2 * side_count, [&](size_t index) {
+		if (index < side_count) {
+		  relax_tile(block_through, block_through, other_block(index));
+		} else {
+		  relax_tile(block_through, other_block(index - side_count), block_through);
+		}
+	  });
+	  workers.ForEachIndex(side_count * side_count, [&](size_t index) {
+		relax_tile(block_through, other_block(index / side_count),
+				   other_block(index % side_count));
+	  });
+	}
+  }
+
+  template <typename Weight, typename StoredWeight>
+  std::optional<typename Router<Weight, StoredWeight>::RouteInfo>
+  Router<Weight, StoredWeight>::BuildRoute(VertexId from, VertexId to) const {
+	const size_t vertex_count = routes_internal_data_.vertex_count;
+	if (from >= vertex_count || to >= vertex_count) {
+	  throw std::out_of_range("Vertex is out of routes table");
+	}
+	const StoredWeight* const weights
+		= routes_internal_data_.weights.data() + from * vertex_count;
+	const CompactEdgeId* const prev_edges
+		= routes_internal_data_.prev_edges.data() + from * vertex_count;
+	if (weights[to] == RoutesInternalData::NO_ROUTE) {
 	  return std::nullopt;
 	}
-	const Weight weight = route_internal_data->weight;
+	const Weight weight = static_cast<Weight>(weights[to]);
 	std::vector<EdgeId> edges;
-	for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge; edge_id;
-		 edge_id
-		 = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge) {
-	  edges.push_back(*edge_id);
+	for (CompactEdgeId edge_id = prev_edges[to]; edge_id != RoutesInternalData::NO_EDGE;
+		 edge_id = prev_edges[graph_.GetEdge(edge_id).from]) {
+	  edges.push_back(edge_id);
 	}
 	std::reverse(edges.begin(), edges.end());
 
 	return RouteInfo {weight, std::move(edges)};
   }
 
+  template <typename Weight, typename StoredWeight>
+  std::vector<std::optional<Weight>> Router<Weight, StoredWeight>::BuildWeights(
+	  const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+	const size_t vertex_count = routes_internal_data_.vertex_count;
+	std::vector<std::optional<Weight>> result;
+	result.reserve(sources.size() * targets.size());
+	for (const VertexId from : sources) {
+	  for (const VertexId to : targets) {
+		if (from >= vertex_count || to >= vertex_count) {
+		  throw std::out_of_range("Vertex is out of routes table");
+		}
+		const StoredWeight weight
+			= routes_internal_data_.weights[routes_internal_data_.Index(from, to)];
+		if (weight == RoutesInternalData::NO_ROUTE) {
+		  result.emplace_back();
+		} else {
+		  result.emplace_back(static_cast<Weight>(weight));
+		}
+	  }
+	}
+	return result;
+  }
+
+  template <typename Weight, typename StoredWeight>
+  std::vector<std::pair<VertexId, Weight>> Router<Weight, StoredWeight>::BuildWeightsWithin(
+	  VertexId from, Weight max_weight) const {
+	const size_t vertex_count = routes_internal_data_.vertex_count;
+	if (from >= vertex_count) {
+	  throw std::out_of_range("Vertex is out of routes table");
+	}
+	const StoredWeight* const weights
+		= routes_internal_data_.weights.data() + from * vertex_count;
+	std::vector<std::pair<VertexId, Weight>> result;
+	for (VertexId to = 0; to < vertex_count; ++to) {
+	  if (weights[to] == RoutesInternalData::NO_ROUTE) {
+		continue;
+	  }
+	  const Weight weight = static_cast<Weight>(weights[to]);
+	  if (!(max_weight < weight)) {
+		result.emplace_back(to, weight);
+	  }
+	}
+	return result;
+  }
+
+  template <typename Weight, typename StoredWeight>
+  void Router<Weight, StoredWeight>::AddVertices(size_t vertex_count) {
+	const size_t old_vertex_count = routes_internal_data_.vertex_count;
+	if (vertex_count <= old_vertex_count) {
+	  return;
+	}
+	RoutesInternalData routes_internal_data;
+	routes_internal_data.Reset(vertex_count);
+	for (VertexId from = 0; from < old_vertex_count; ++from) {
+	  const size_t old_row = from * old_vertex_count;
+	  std::copy_n(routes_internal_data_.weights.begin() + old_row, old_vertex_count,
+				  routes_internal_data.weights.begin() + routes_internal_data.Index(from, 0));
+	  std::copy_n(routes_internal_data_.prev_edges.begin() + old_row, old_vertex_count,
+				  routes_internal_data.prev_edges.begin() + routes_internal_data.Index(from, 0));
+	}
+	for (VertexId vertex = old_vertex_count; vertex < vertex_count; ++vertex) {
+	  routes_internal_data.weights[routes_internal_data.Index(vertex, vertex)] = ZERO_WEIGHT;
+	}
+	routes_internal_data_ = std::move(routes_internal_data);
+  }
+
+  template <typename Weight, typename StoredWeight>
+  void Router<Weight, StoredWeight>::RenumberEdges(const std::vector<EdgeId>& new_ids) {
+	for (CompactEdgeId& edge_id : routes_internal_data_.prev_edges) {
+	  if (edge_id != RoutesInternalData::NO_EDGE) {
+		edge_id = static_cast<CompactEdgeId>(new_ids[edge_id]);
+	  }
+	}
+  }
+
+  template <typename Weight, typename StoredWeight>
+  void Router<Weight, StoredWeight>::UpdateEdges(const std::vector<EdgeId>& increased_edges,
+												 const std::vector<EdgeId>& decreased_edges) {
+	if (graph_.GetEdgeCount() >= RoutesInternalData::NO_EDGE) {
+	  throw std::length_error("Too many edges for the routes table");
+	}
+	const size_t vertex_count = routes_internal_data_.vertex_count;
+
+	/// a route goes through an edge iff the edge is the previous one of its target
+	if (!increased_edges.empty()) {
+	  std::vector<VertexId> rows;
+	  for (VertexId from = 0; from < vertex_count; ++from) {
+		const CompactEdgeId* const prev_edges
+			= routes_internal_data_.prev_edges.data() + from * vertex_count;
+		for (const EdgeId edge_id : increased_edges) {
+		  if (prev_edges[graph_.GetEdge(edge_id).to] == edge_id) {
+			rows.push_back(from);
+			break;
+		  }
+		}
+	  }
+	  for (const VertexId from : rows) {
+		RecomputeRoutesInternalDataRow(from);
+	  }
+	}
+
+	std::vector<VertexId> vertexes_through;
+	for (const EdgeId edge_id : decreased_edges) {
+	  const auto& edge = graph_.GetEdge(edge_id);
+	  if (edge.weight < Weight {}) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	  const size_t index = routes_internal_data_.Index(edge.from, edge.to);
+	  const StoredWeight weight = static_cast<StoredWeight>(edge.weight);
+	  if (weight < routes_internal_data_.weights[index]) {
+		routes_internal_data_.weights[index] = weight;
+		routes_internal_data_.prev_edges[index] = static_cast<CompactEdgeId>(edge_id);
+	  }
+	  vertexes_through.push_back(edge.from);
+	  vertexes_through.push_back(edge.to);
+	}
+	std::sort(vertexes_through.begin(), vertexes_through.end());
+	vertexes_through.erase(std::unique(vertexes_through.begin(), vertexes_through.end()),
+						   vertexes_through.end());
+	for (const VertexId vertex_through : vertexes_through) {
+	  RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+	}
+  }
+
+  template <typename Weight, typename StoredWeight>
+  void Router<Weight, StoredWeight>::RecomputeRoutesInternalDataRow(VertexId from) {
+	const size_t vertex_count = routes_internal_data_.vertex_count;
+	StoredWeight* const row_weights
+		= routes_internal_data_.weights.data() + from * vertex_count;
+	CompactEdgeId* const row_prev_edges
+		= routes_internal_data_.prev_edges.data() + from * vertex_count;
+	std::vector<Weight> weights(vertex_count);
+	std::vector<bool> reached(vertex_count, false);
+	std::fill_n(row_weights, vertex_count, RoutesInternalData::NO_ROUTE);
+	std::fill_n(row_prev_edges, vertex_count, RoutesInternalData::NO_EDGE);
+
+	using QueueItem = std::pair<Weight, VertexId>;
+	std::vector<QueueItem> heap;
+	weights[from] = Weight {};
+	reached[from] = true;
+	heap.push_back({Weight {}, from});
+	while (!heap.empty()) {
+	  std::pop_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+	  const auto [weight, vertex] = heap.back();
+	  heap.pop_back();
+	  if (weight > weights[vertex]) {
+		continue;
+	  }
+	  for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+		const auto& edge = graph_.GetEdge(edge_id);
+		const Weight candidate_weight = weight + edge.weight;
+		if (!reached[edge.to] || candidate_weight < weights[edge.to]) {
+		  reached[edge.to] = true;
+		  weights[edge.to] = candidate_weight;
+		  row_prev_edges[edge.to] = static_cast<CompactEdgeId>(edge_id);
+		  heap.push_back({candidate_weight, edge.to});
+		  std::push_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+		}
+	  }
+	}
+	for (VertexId to = 0; to < vertex_count; ++to) {
+	  if (reached[to]) {
+		row_weights[to] = static_cast<StoredWeight>(weights[to]);
+	  }
+	}
+	row_prev_edges[from] = RoutesInternalData::NO_EDGE;
+  }
+
 }  // namespace graph
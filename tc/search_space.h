@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "graph.h"
+
+namespace graph {
+
+  /// Buffers of a Dijkstra search kept between searches: weights and prevs
+  /// hold only for the reached vertices, and a reset clears just the vertices
+  /// the last search touched. Prev is what leads back to the source, an edge
+  /// id or an arc of the router.
+  template <typename Weight, typename Prev>
+  struct SearchSpace {
+	struct QueueItem {
+	  Weight weight;
+	  VertexId vertex;
+
+	  bool operator>(const QueueItem& other) const {
+		return weight > other.weight;
+	  }
+	};
+
+	std::vector<Weight> weights;
+	std::vector<Prev> prevs;
+	std::vector<bool> reached;
+	std::vector<VertexId> touched;
+	std::vector<QueueItem> heap;
+
+	/// Sizes the buffers for the graph, a no-op while its vertex count stays.
+	void Prepare(size_t vertex_count) {
+	  if (weights.size() != vertex_count) {
+		weights.assign(vertex_count, Weight {});
+		prevs.assign(vertex_count, Prev {});
+		reached.assign(vertex_count, false);
+		touched.clear();
+	  }
+	}
+
+	void Reset() {
+	  for (const VertexId vertex : touched) {
+		reached[vertex] = false;
+	  }
+	  touched.clear();
+	  heap.clear();
+	}
+
+	void Reach(VertexId vertex, Weight weight, const Prev& prev) {
+	  if (!reached[vertex]) {
+		reached[vertex] = true;
+		touched.push_back(vertex);
+	  }
+	  weights[vertex] = weight;
+	  prevs[vertex] = prev;
+	  heap.push_back({weight, vertex});
+	  std::push_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+	}
+
+	/// True if the vertex is unreached or reached heavier than weight.
+	bool IsImprovedBy(VertexId vertex, Weight weight) const {
+	  return !reached[vertex] || weight < weights[vertex];
+	}
+
+	QueueItem Pop() {
+	  std::pop_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+	  const QueueItem item = heap.back();
+	  heap.pop_back();
+	  return item;
+	}
+  };
+
+}  // namespace graph
@@ -146,8 +146,33 @@ namespace serial {
 	*tmp_transp_router.mutable_settings() = std::move(SerializeRouterSettingsData());
 	*tmp_transp_router.mutable_transport_router()
 		= std::move(SerializeTransportRouterClassData());
-	*tmp_transp_router.mutable_router() = std::move(SerializeRouterData());
+	switch (router_.GetSettings().engine) {
+	  case transport::RouterEngine::FLOYD_WARSHALL:
+		*tmp_transp_router.mutable_router() = std::move(SerializeRouterData());
+		break;
+	  case transport::RouterEngine::CONTRACTION_HIERARCHY:
+		*tmp_transp_router.mutable_contraction_hierarchy()
+			= std::move(SerializeContractionHierarchyData());
+		break;
+	  case transport::RouterEngine::HUB_LABELS:
+		*tmp_transp_router.mutable_hub_labels() = std::move(SerializeHubLabelsData());
+		break;
+	  case transport::RouterEngine::PARTIAL:
+		*tmp_transp_router.mutable_partial_router() = std::move(SerializePartialRouterData());
+		break;
+	  case transport::RouterEngine::OVERLAY:
+		*tmp_transp_router.mutable_overlay() = std::move(SerializeOverlayData());
+		break;
+	  case transport::RouterEngine::A_STAR:
+		*tmp_transp_router.mutable_landmarks() = std::move(SerializeLandmarksData());
+		break;
+	  case transport::RouterEngine::DIJKSTRA:
+	  case transport::RouterEngine::RAPTOR:
+		break;
+	}
 	*tmp_transp_router.mutable_graph() = std::move(SerializeGraphData());
+	*tmp_transp_router.mutable_components() = std::move(SerializeComponentsData());
+	*tmp_transp_router.mutable_statistics() = std::move(SerializeStatisticsData());
 
 	return tmp_transp_router;
   }
@@ -157,6 +182,18 @@ namespace serial {
 	transport::RouterSettings cat_router_set = router_.GetSettings();
 	tmp_router_settings.set_bus_velocity_kmh(cat_router_set.bus_velocity_kmh);
 	tmp_router_settings.set_bus_wait_time(cat_router_set.bus_wait_time);
+	tmp_router_settings.set_engine(static_cast<int>(cat_router_set.engine));
+	tmp_router_settings.set_float_weights(cat_router_set.float_weights);
+	tmp_router_settings.set_route_cache_size(std::max(cat_router_set.route_cache_size, 0));
+	tmp_router_settings.set_promote_after(std::max(cat_router_set.promote_after, 0));
+	tmp_router_settings.set_overlay_cell_size(std::max(cat_router_set.overlay_cell_size, 0));
+	tmp_router_settings.set_overlay_levels(std::max(cat_router_set.overlay_levels, 0));
+	tmp_router_settings.set_landmark_count(std::max(cat_router_set.landmark_count, 0));
+	tmp_router_settings.set_fixed_point_weights(cat_router_set.fixed_point_weights);
+	tmp_router_settings.set_single_vertex_stops(cat_router_set.single_vertex_stops);
+	tmp_router_settings.set_compact_graph(cat_router_set.compact_graph);
+	tmp_router_settings.set_memory_budget_mb(std::max(cat_router_set.memory_budget_mb, 0));
+	tmp_router_settings.set_build_time_budget_s(std::max(cat_router_set.build_time_budget_s, 0));
 	return tmp_router_settings;
   }
 
@@ -168,6 +205,7 @@ namespace serial {
 	  tmp_transp_router_class_data.mutable_vertexes(i)->set_stop_id(
 		  ser_stops_ind.at(name));
 	  tmp_transp_router_class_data.mutable_vertexes(i)->set_id(data.in.id);
+	  tmp_transp_router_class_data.mutable_vertexes(i)->set_out_id(data.out.id);
 	  ++i;
 	}
 	int j = 0;
@@ -184,55 +222,163 @@ namespace serial {
 	  }
 	  tmp_transp_router_class_data.mutable_edges(j)->set_span_count(edge.span_count);
 	  tmp_transp_router_class_data.mutable_edges(j)->set_time(edge.time);
+	  tmp_transp_router_class_data.mutable_edges(j)->set_distance(edge.distance);
+	  for (const std::string_view bus : edge.other_buses) {
+		tmp_transp_router_class_data.mutable_edges(j)->add_other_name_ids(
+			ser_buses_ind.at(bus));
+	  }
 	  ++j;
 	}
 	return tmp_transp_router_class_data;
   }
 
   proto_transport::Router Serializator::SerializeRouterData() {
+	if (router_.UsesFixedPointWeights()) {
+	  return SerializeRoutesTableData(router_.GetRouterData<transport::FixedWeight>());
+	}
+	if (router_.GetSettings().float_weights) {
+	  return SerializeRoutesTableData(router_.GetRouterData<float>());
+	}
+	return SerializeRoutesTableData(router_.GetRouterData<double>());
+  }
+
+  template <typename StoredWeight>
+  proto_transport::Router Serializator::SerializeRoutesTableData(
+	  const graph::RoutesTable<StoredWeight>& table) {
 	proto_transport::Router tmp_router;
-	int i = 0;
-	for (const auto& data_vector : router_.GetRouterData()) {
-	  int j = 0;
-	  tmp_router.add_routes_internal_data();
-	  for (const auto& data : data_vector) {
-		tmp_router.mutable_routes_internal_data(i)->add_route_internal_data_elem();
-		if (data) {
-		  proto_transport::RouteInternalData& elem_data
-			  = *tmp_router.mutable_routes_internal_data(i)
-					 ->mutable_route_internal_data_elem(j)
-					 ->mutable_data();
-		  elem_data.set_weight(data.value().weight);
-		  if (data.value().prev_edge) {
-			elem_data.set_edgeid(data.value().prev_edge.value());
-		  }
-		}
-		++j;
-	  }
-	  ++i;
+	tmp_router.set_vertex_count(table.vertex_count);
+	if constexpr (std::is_same_v<StoredWeight, float>) {
+	  tmp_router.mutable_float_weights()->Add(table.weights.begin(), table.weights.end());
+	} else if constexpr (std::is_same_v<StoredWeight, transport::FixedWeight>) {
+	  tmp_router.mutable_fixed_weights()->Add(table.weights.begin(), table.weights.end());
+	} else {
+	  tmp_router.mutable_weights()->Add(table.weights.begin(), table.weights.end());
 	}
+	tmp_router.mutable_prev_edges()->Add(table.prev_edges.begin(), table.prev_edges.end());
 	return tmp_router;
   }
 
+  proto_transport::ContractionHierarchy
+  Serializator::SerializeContractionHierarchyData() {
+	proto_transport::ContractionHierarchy tmp_hierarchy;
+	const auto& hierarchy_data = router_.GetContractionHierarchyData();
+	for (const auto& edge : hierarchy_data.edges) {
+	  proto_transport::HierarchyEdge& tmp_edge = *tmp_hierarchy.add_edges();
+	  tmp_edge.set_from(edge.from);
+	  tmp_edge.set_to(edge.to);
+	  tmp_edge.set_weight(edge.weight);
+	  if (edge.original_edge != graph::ContractionHierarchy<double>::NO_EDGE) {
+		tmp_edge.set_original_edge(edge.original_edge);
+	  } else {
+		tmp_edge.mutable_shortcut()->set_first_child(edge.first_child);
+		tmp_edge.mutable_shortcut()->set_second_child(edge.second_child);
+	  }
+	}
+	for (const auto& list : hierarchy_data.upward) {
+	  proto_transport::IncidenceList& tmp_list = *tmp_hierarchy.add_upward();
+	  for (const auto edge_id : list) {
+		tmp_list.add_edges(edge_id);
+	  }
+	}
+	for (const auto& list : hierarchy_data.downward) {
+	  proto_transport::IncidenceList& tmp_list = *tmp_hierarchy.add_downward();
+	  for (const auto edge_id : list) {
+		tmp_list.add_edges(edge_id);
+	  }
+	}
+	return tmp_hierarchy;
+  }
+
+  proto_transport::HubLabels Serializator::SerializeHubLabelsData() {
+	proto_transport::HubLabels tmp_labels;
+	const auto& label_data = router_.GetHubLabelData();
+	*tmp_labels.mutable_forward() = SerializeHubLabelSetData(label_data.forward);
+	*tmp_labels.mutable_backward() = SerializeHubLabelSetData(label_data.backward);
+	return tmp_labels;
+  }
+
+  proto_transport::HubLabelSet Serializator::SerializeHubLabelSetData(
+	  const graph::HubLabels<double>::LabelSet& set) {
+	proto_transport::HubLabelSet tmp_set;
+	tmp_set.mutable_offsets()->Add(set.offsets.begin(), set.offsets.end());
+	tmp_set.mutable_hubs()->Add(set.hubs.begin(), set.hubs.end());
+	tmp_set.mutable_weights()->Add(set.weights.begin(), set.weights.end());
+	tmp_set.mutable_edges()->Add(set.edges.begin(), set.edges.end());
+	return tmp_set;
+  }
+
+  proto_transport::PartialRouter Serializator::SerializePartialRouterData() {
+	proto_transport::PartialRouter tmp_partial;
+	for (const auto& tree : router_.GetPartialRouter().GetTrees()) {
+	  proto_transport::SourceTree& tmp_tree = *tmp_partial.add_trees();
+	  tmp_tree.set_source(tree->source);
+	  tmp_tree.mutable_weights()->Add(tree->weights.begin(), tree->weights.end());
+	  tmp_tree.mutable_prev_edges()->Add(tree->prev_edges.begin(), tree->prev_edges.end());
+	}
+	return tmp_partial;
+  }
+
+  proto_transport::MultiLevelOverlay Serializator::SerializeOverlayData() {
+	proto_transport::MultiLevelOverlay tmp_overlay;
+	for (const auto& level : router_.GetOverlayData().levels) {
+	  proto_transport::OverlayLevel& tmp_level = *tmp_overlay.add_levels();
+	  tmp_level.mutable_cells()->Add(level.cells.begin(), level.cells.end());
+	  tmp_level.mutable_entry_offsets()->Add(level.entry_offsets.begin(),
+											 level.entry_offsets.end());
+	  tmp_level.mutable_entries()->Add(level.entries.begin(), level.entries.end());
+	  tmp_level.mutable_exit_offsets()->Add(level.exit_offsets.begin(), level.exit_offsets.end());
+	  tmp_level.mutable_exits()->Add(level.exits.begin(), level.exits.end());
+	  tmp_level.mutable_clique_offsets()->Add(level.clique_offsets.begin(),
+											  level.clique_offsets.end());
+	  tmp_level.mutable_clique_weights()->Add(level.clique_weights.begin(),
+											  level.clique_weights.end());
+	}
+	return tmp_overlay;
+  }
+
+  proto_transport::Components Serializator::SerializeComponentsData() {
+	proto_transport::Components tmp_components;
+	const auto& component_data = router_.GetComponentData();
+	tmp_components.mutable_components()->Add(component_data.components.begin(),
+											 component_data.components.end());
+	tmp_components.mutable_subnetworks()->Add(component_data.subnetworks.begin(),
+											  component_data.subnetworks.end());
+	return tmp_components;
+  }
+
+  proto_transport::RouterStatistics Serializator::SerializeStatisticsData() {
+	proto_transport::RouterStatistics tmp_statistics;
+	const transport::RouterStatistics& statistics = router_.GetStatistics();
+	tmp_statistics.set_auto_engine(statistics.auto_engine);
+	tmp_statistics.set_vertex_count(statistics.vertex_count);
+	tmp_statistics.set_edge_count(statistics.edge_count);
+	tmp_statistics.set_memory_bytes(statistics.memory_bytes);
+	tmp_statistics.set_build_seconds(statistics.build_seconds);
+	return tmp_statistics;
+  }
+
+  proto_transport::Landmarks Serializator::SerializeLandmarksData() {
+	proto_transport::Landmarks tmp_landmarks;
+	const auto& landmark_data = router_.GetLandmarkData();
+	tmp_landmarks.mutable_landmarks()->Add(landmark_data.landmarks.begin(),
+										   landmark_data.landmarks.end());
+	tmp_landmarks.mutable_weights_from()->Add(landmark_data.weights_from.begin(),
+											  landmark_data.weights_from.end());
+	tmp_landmarks.mutable_weights_to()->Add(landmark_data.weights_to.begin(),
+											landmark_data.weights_to.end());
+	return tmp_landmarks;
+  }
+
   proto_transport::Graph Serializator::SerializeGraphData() {
 	proto_transport::Graph tmp_graph;
-	for (int i = 0; i < router_.GetGraph().GetEdgeCount(); ++i) {
-	  graph::Edge tmp_cat_edge = router_.GetGraph().GetEdge(i);
-	  tmp_graph.add_edges();
-	  proto_transport::Edge& tmp_base_edge = *tmp_graph.mutable_edges(i);
-	  tmp_base_edge.set_from(tmp_cat_edge.from);
-	  tmp_base_edge.set_to(tmp_cat_edge.to);
-	  tmp_base_edge.set_weight(tmp_cat_edge.weight);
-	}
-	for (size_t i = 0; i < router_.GetGraph().GetVertexCount(); ++i) {
-	  tmp_graph.add_incidence_lists();
-	  proto_transport::IncidenceList& tmp_base_inc_list
-		  = *tmp_graph.mutable_incidence_lists(i);
-	  int j = 0;
-	  for (const auto inc_edge : router_.GetGraph().GetIncidentEdges(i)) {
-		tmp_base_inc_list.add_edges(inc_edge);
-		++j;
-	  }
+	const auto& cat_graph = router_.GetGraph();
+	tmp_graph.mutable_offsets()->Add(cat_graph.GetOffsets().begin(),
+									 cat_graph.GetOffsets().end());
+	tmp_graph.mutable_targets()->Reserve(cat_graph.GetEdgeCount());
+	tmp_graph.mutable_weights()->Reserve(cat_graph.GetEdgeCount());
+	for (graph::EdgeId i = 0; i < cat_graph.GetEdgeCount(); ++i) {
+	  tmp_graph.add_targets(cat_graph.GetEdge(i).to);
+	  tmp_graph.add_weights(cat_graph.GetEdge(i).weight);
 	}
 	return tmp_graph;
   }
@@ -253,10 +399,39 @@ namespace deserial {
 
 	DeserializeCatalogueData(base.catalogue());
 	DeserializeMapRendererData(base.map_renderer());
+	router_.SetSettings(
+		DeserializeTrasnportRouterSettingsData(base.transport_router().settings()));
 	router_.GenerateEmptyRouter();
 	DeserializeTransportRouterData(base.transport_router());
-	DeserializeRouterData(base.transport_router().router());
-	DeserializeGraphData(base.transport_router().graph());
+	router_.IndexVertexStops();
+	router_.BuildFixedPointGraph();
+	DeserializeComponentsData(base.transport_router().components());
+	DeserializeStatisticsData(base.transport_router().statistics());
+	switch (router_.GetSettings().engine) {
+	  case transport::RouterEngine::FLOYD_WARSHALL:
+		DeserializeRouterData(base.transport_router().router());
+		break;
+	  case transport::RouterEngine::CONTRACTION_HIERARCHY:
+		DeserializeContractionHierarchyData(
+			base.transport_router().contraction_hierarchy());
+		break;
+	  case transport::RouterEngine::HUB_LABELS:
+		DeserializeHubLabelsData(base.transport_router().hub_labels());
+		break;
+	  case transport::RouterEngine::PARTIAL:
+		DeserializePartialRouterData(base.transport_router().partial_router());
+		break;
+	  case transport::RouterEngine::OVERLAY:
+		DeserializeOverlayData(base.transport_router().overlay());
+		break;
+	  case transport::RouterEngine::DIJKSTRA:
+	  case transport::RouterEngine::RAPTOR:
+		break;
+	  case transport::RouterEngine::A_STAR:
+		DeserializeLandmarksData(base.transport_router().landmarks());
+		router_.EnableLowerBound();
+		break;
+	}
   }
 
   void DeSerializator::SetSettings(const transport::SerializationSettings& settings) {
@@ -351,6 +526,19 @@ namespace deserial {
 	transport_router::RouterSettings tmp_settings;
 	tmp_settings.bus_velocity_kmh = base_router_settings.bus_velocity_kmh();
 	tmp_settings.bus_wait_time = base_router_settings.bus_wait_time();
+	tmp_settings.engine = static_cast<transport::RouterEngine>(base_router_settings.engine());
+	tmp_settings.float_weights = base_router_settings.float_weights();
+	tmp_settings.route_cache_size = static_cast<int>(base_router_settings.route_cache_size());
+	tmp_settings.promote_after = static_cast<int>(base_router_settings.promote_after());
+	tmp_settings.overlay_cell_size = static_cast<int>(base_router_settings.overlay_cell_size());
+	tmp_settings.overlay_levels = static_cast<int>(base_router_settings.overlay_levels());
+	tmp_settings.landmark_count = static_cast<int>(base_router_settings.landmark_count());
+	tmp_settings.fixed_point_weights = base_router_settings.fixed_point_weights();
+	tmp_settings.single_vertex_stops = base_router_settings.single_vertex_stops();
+	tmp_settings.compact_graph = base_router_settings.compact_graph();
+	tmp_settings.memory_budget_mb = static_cast<int>(base_router_settings.memory_budget_mb());
+	tmp_settings.build_time_budget_s
+		= static_cast<int>(base_router_settings.build_time_budget_s());
 	return tmp_settings;
   }
 
@@ -366,9 +554,10 @@ namespace deserial {
 	  const proto_transport::TransportRouterData& base_transport_router_data) {
 	Vertexes tmp_vertexes;
 	for (int i = 0; i < base_transport_router_data.vertexes_size(); ++i) {
-	  tmp_vertexes[deser_stops_ind.at(base_transport_router_data.vertexes(i).stop_id())]
-		  .in.id
-		  = base_transport_router_data.vertexes(i).id();
+	  transport_router::StopAsVertexes& vertexes
+		  = tmp_vertexes[deser_stops_ind.at(base_transport_router_data.vertexes(i).stop_id())];
+	  vertexes.in.id = base_transport_router_data.vertexes(i).id();
+	  vertexes.out.id = base_transport_router_data.vertexes(i).out_id();
 	}
 	return tmp_vertexes;
   }
@@ -393,86 +582,173 @@ namespace deserial {
 	  }
 	  tmp_edge.time = base_transport_router_data.edges(i).time();
 	  tmp_edge.span_count = base_transport_router_data.edges(i).span_count();
+	  tmp_edge.distance = static_cast<int>(base_transport_router_data.edges(i).distance());
+	  for (const uint32_t bus_id : base_transport_router_data.edges(i).other_name_ids()) {
+		tmp_edge.other_buses.push_back(deser_buses_ind.at(bus_id));
+	  }
 	  tmp_edges.emplace_back(std::move(tmp_edge));
 	}
 	return tmp_edges;
   }
   /// ROUTER
   void DeSerializator::DeserializeRouterData(const proto_transport::Router& base_router) {
-	std::vector<std::vector<std::optional<graph::Router<double>::RouteInternalData>>>&
-		routes_internal_data
-		= router_.ModifyRouter().get()->ModifyRoutesInternalData();
-	routes_internal_data.resize(base_router.routes_internal_data_size());
-	for (int i = 0; i < base_router.routes_internal_data_size(); ++i) {
-	  routes_internal_data[i].reserve(
-		  base_router.routes_internal_data(i).route_internal_data_elem_size());
-	  for (int j = 0;
-		   j < base_router.routes_internal_data(i).route_internal_data_elem_size(); ++j) {
-		proto_transport::RouteInternalDataVectorElem base_elem
-			= base_router.routes_internal_data(i).route_internal_data_elem(j);
-		routes_internal_data[i].emplace_back(
-			std::move(DeserializeRouteInternalData(base_elem)));
+	if (router_.UsesFixedPointWeights()) {
+	  graph::RoutesTable<transport::FixedWeight>& table
+		  = router_.ModifyRouterData<transport::FixedWeight>();
+	  table.vertex_count = base_router.vertex_count();
+	  table.weights.assign(base_router.fixed_weights().begin(),
+						   base_router.fixed_weights().end());
+	  table.prev_edges.assign(base_router.prev_edges().begin(),
+							  base_router.prev_edges().end());
+	} else if (router_.GetSettings().float_weights) {
+	  graph::RoutesTable<float>& table = router_.ModifyRouterData<float>();
+	  table.vertex_count = base_router.vertex_count();
+	  table.weights.assign(base_router.float_weights().begin(),
+						   base_router.float_weights().end());
+	  table.prev_edges.assign(base_router.prev_edges().begin(),
+							  base_router.prev_edges().end());
+	} else {
+	  graph::RoutesTable<double>& table = router_.ModifyRouterData<double>();
+	  table.vertex_count = base_router.vertex_count();
+	  table.weights.assign(base_router.weights().begin(), base_router.weights().end());
+	  table.prev_edges.assign(base_router.prev_edges().begin(),
+							  base_router.prev_edges().end());
+	}
+  }
+
+  /// CONTRACTION HIERARCHY
+  void DeSerializator::DeserializeContractionHierarchyData(
+	  const proto_transport::ContractionHierarchy& base_hierarchy) {
+	using Hierarchy = graph::ContractionHierarchy<double>;
+	Hierarchy::HierarchyData& hierarchy_data
+		= router_.ModifyContractionHierarchy()->ModifyHierarchyData();
+	hierarchy_data.edges.reserve(base_hierarchy.edges_size());
+	for (const auto& base_edge : base_hierarchy.edges()) {
+	  Hierarchy::HierarchyEdge tmp_edge {base_edge.from(), base_edge.to(),
+										 base_edge.weight()};
+	  if (base_edge.origin_case()
+		  == proto_transport::HierarchyEdge::OriginCase::kOriginalEdge) {
+		tmp_edge.original_edge = base_edge.original_edge();
+	  } else {
+		tmp_edge.first_child = base_edge.shortcut().first_child();
+		tmp_edge.second_child = base_edge.shortcut().second_child();
 	  }
+	  hierarchy_data.edges.push_back(tmp_edge);
 	}
+	hierarchy_data.upward.reserve(base_hierarchy.upward_size());
+	for (const auto& base_list : base_hierarchy.upward()) {
+	  hierarchy_data.upward.emplace_back(base_list.edges().begin(),
+										 base_list.edges().end());
+	}
+	hierarchy_data.downward.reserve(base_hierarchy.downward_size());
+	for (const auto& base_list : base_hierarchy.downward()) {
+	  hierarchy_data.downward.emplace_back(base_list.edges().begin(),
+										   base_list.edges().end());
+	}
+  }
+  /// HUB LABELS
+  void DeSerializator::DeserializeHubLabelsData(
+	  const proto_transport::HubLabels& base_labels) {
+	graph::HubLabels<double>::LabelData& label_data = router_.ModifyHubLabelData();
+	DeserializeHubLabelSetData(base_labels.forward(), label_data.forward);
+	DeserializeHubLabelSetData(base_labels.backward(), label_data.backward);
   }
 
-  std::optional<graph::Router<double>::RouteInternalData>
-  DeSerializator::DeserializeRouteInternalData(
-	  proto_transport::RouteInternalDataVectorElem& base) {
-	graph::Router<double>::RouteInternalData res {};
-	switch (base.elem_case()) {
-	  case proto_transport::RouteInternalDataVectorElem::ElemCase::ELEM_NOT_SET:
-		return std::nullopt;
-		break;
-	  case proto_transport::RouteInternalDataVectorElem::ElemCase::kData:
-		res.weight = base.data().weight();
-		switch (base.data().prev_edge_case()) {
-		  case proto_transport::RouteInternalData::PrevEdgeCase::kEdgeid:
-			res.prev_edge = std::make_optional(base.data().edgeid());
-			break;
-		  case proto_transport::RouteInternalData::PrevEdgeCase::PREV_EDGE_NOT_SET:
-			res.prev_edge = std::nullopt;
-			break;
-		}
-	}
-	return res;
+  void DeSerializator::DeserializeHubLabelSetData(
+	  const proto_transport::HubLabelSet& base_set, graph::HubLabels<double>::LabelSet& set) {
+	set.offsets.assign(base_set.offsets().begin(), base_set.offsets().end());
+	set.hubs.assign(base_set.hubs().begin(), base_set.hubs().end());
+	set.weights.assign(base_set.weights().begin(), base_set.weights().end());
+	set.edges.assign(base_set.edges().begin(), base_set.edges().end());
+  }
+  /// PARTIAL ROUTER
+  void DeSerializator::DeserializePartialRouterData(
+	  const proto_transport::PartialRouter& base_partial) {
+	graph::PartialRouter<double>& partial_router = router_.ModifyPartialRouter();
+	for (const auto& base_tree : base_partial.trees()) {
+	  partial_router.AddTree({base_tree.source(),
+							  {base_tree.weights().begin(), base_tree.weights().end()},
+							  {base_tree.prev_edges().begin(), base_tree.prev_edges().end()}});
+	}
+  }
+  /// MULTI-LEVEL OVERLAY
+  void DeSerializator::DeserializeOverlayData(
+	  const proto_transport::MultiLevelOverlay& base_overlay) {
+	auto& overlay_data = router_.ModifyOverlayData();
+	overlay_data.levels.resize(base_overlay.levels_size());
+	for (int i = 0; i < base_overlay.levels_size(); ++i) {
+	  const proto_transport::OverlayLevel& base_level = base_overlay.levels(i);
+	  auto& level = overlay_data.levels[i];
+	  level.cells.assign(base_level.cells().begin(), base_level.cells().end());
+	  level.entry_offsets.assign(base_level.entry_offsets().begin(),
+								 base_level.entry_offsets().end());
+	  level.entries.assign(base_level.entries().begin(), base_level.entries().end());
+	  level.exit_offsets.assign(base_level.exit_offsets().begin(),
+								base_level.exit_offsets().end());
+	  level.exits.assign(base_level.exits().begin(), base_level.exits().end());
+	  level.clique_offsets.assign(base_level.clique_offsets().begin(),
+								  base_level.clique_offsets().end());
+	  level.clique_weights.assign(base_level.clique_weights().begin(),
+								  base_level.clique_weights().end());
+	}
+  }
+  /// ALT LANDMARKS
+  void DeSerializator::DeserializeLandmarksData(
+	  const proto_transport::Landmarks& base_landmarks) {
+	auto& landmark_data = router_.ModifyLandmarkData();
+	landmark_data.landmarks.assign(base_landmarks.landmarks().begin(),
+								   base_landmarks.landmarks().end());
+	landmark_data.weights_from.assign(base_landmarks.weights_from().begin(),
+									  base_landmarks.weights_from().end());
+	landmark_data.weights_to.assign(base_landmarks.weights_to().begin(),
+									base_landmarks.weights_to().end());
+  }
+  /// COMPONENTS
+  void DeSerializator::DeserializeComponentsData(
+	  const proto_transport::Components& base_components) {
+	const size_t vertex_count = router_.GetGraph().GetVertexCount();
+	if (static_cast<size_t>(base_components.components_size()) != vertex_count
+		|| static_cast<size_t>(base_components.subnetworks_size()) != vertex_count) {
+	  router_.FindComponents();
+	  return;
+	}
+	auto& component_data = router_.ModifyComponentData();
+	component_data.components.assign(base_components.components().begin(),
+									 base_components.components().end());
+	component_data.subnetworks.assign(base_components.subnetworks().begin(),
+									  base_components.subnetworks().end());
+  }
+  /// STATISTICS
+  void DeSerializator::DeserializeStatisticsData(
+	  const proto_transport::RouterStatistics& base_statistics) {
+	transport::RouterStatistics& statistics = router_.ModifyStatistics();
+	statistics.auto_engine = base_statistics.auto_engine();
+	statistics.vertex_count = base_statistics.vertex_count();
+	statistics.edge_count = base_statistics.edge_count();
+	statistics.memory_bytes = base_statistics.memory_bytes();
+	statistics.build_seconds = base_statistics.build_seconds();
   }
   /// GRAPH
   void DeSerializator::DeserializeGraphData(
 	  const proto_transport::Graph& base_graph_data) {
+	router_.ModifyGraph().ModifyOffsets().assign(base_graph_data.offsets().begin(),
+												 base_graph_data.offsets().end());
 	router_.ModifyGraph().ModifyEdges()
 		= std::move(DeserializeGraphEdgesData(base_graph_data));
-	router_.ModifyGraph().ModifyIncidenceLists()
-		= std::move(DeserializeGraphIncidenceListsData(base_graph_data));
   }
 
   std::vector<graph::Edge<double>> DeSerializator::DeserializeGraphEdgesData(
 	  const proto_transport::Graph& base_graph_data) {
 	std::vector<graph::Edge<double>> tmp_edges;
-	;
-	tmp_edges.reserve(base_graph_data.edges_size());
-	for (int i = 0; i < base_graph_data.edges_size(); ++i) {
-	  graph::Edge<double> tmp_edge;
-	  tmp_edge.from = base_graph_data.edges(i).from();
-	  tmp_edge.to = base_graph_data.edges(i).to();
-	  tmp_edge.weight = base_graph_data.edges(i).weight();
-	  tmp_edges.emplace_back(std::move(tmp_edge));
-	}
-	return tmp_edges;
-  }
-
-  std::vector<graph::IncidenceList> DeSerializator::DeserializeGraphIncidenceListsData(
-	  const proto_transport::Graph& base_graph_data) {
-	std::vector<graph::IncidenceList> tmp_inc_lists;
-	tmp_inc_lists.reserve(base_graph_data.incidence_lists_size());
-	for (int i = 0; i < base_graph_data.incidence_lists_size(); ++i) {
-	  graph::IncidenceList tmp_list;
-	  tmp_list.reserve(base_graph_data.incidence_lists(i).edges_size());
-	  for (int j = 0; j < base_graph_data.incidence_lists(i).edges_size(); ++j) {
-		tmp_list.emplace_back(base_graph_data.incidence_lists(i).edges(j));
+	tmp_edges.reserve(base_graph_data.targets_size());
+	for (int from = 0; from + 1 < base_graph_data.offsets_size(); ++from) {
+	  for (uint32_t i = base_graph_data.offsets(from); i < base_graph_data.offsets(from + 1);
+		   ++i) {
+		tmp_edges.push_back(
+			{static_cast<graph::VertexId>(from), base_graph_data.targets(i),
+			 base_graph_data.weights(i)});
 	  }
-	  tmp_inc_lists.emplace_back(std::move(tmp_list));
 	}
-	return tmp_inc_lists;
+	return tmp_edges;
   }
 }  // namespace deserial
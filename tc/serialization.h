@@ -44,6 +44,18 @@ namespace serial {
 	proto_transport::RouterSettings SerializeRouterSettingsData();
 	proto_transport::TransportRouterData SerializeTransportRouterClassData();
 	proto_transport::Router SerializeRouterData();
+	template <typename StoredWeight>
+	proto_transport::Router SerializeRoutesTableData(
+		const graph::RoutesTable<StoredWeight>& table);
+	proto_transport::ContractionHierarchy SerializeContractionHierarchyData();
+	proto_transport::HubLabels SerializeHubLabelsData();
+	proto_transport::HubLabelSet SerializeHubLabelSetData(
+		const graph::HubLabels<double>::LabelSet& set);
+	proto_transport::PartialRouter SerializePartialRouterData();
+	proto_transport::MultiLevelOverlay SerializeOverlayData();
+	proto_transport::Landmarks SerializeLandmarksData();
+	proto_transport::Components SerializeComponentsData();
+	proto_transport::RouterStatistics SerializeStatisticsData();
 	proto_transport::Graph SerializeGraphData();
 
   private:
@@ -96,12 +108,25 @@ namespace deserial {
 	void DeserializeGraphData(const proto_transport::Graph& base_graph_data);
 	std::vector<graph::Edge<double>> DeserializeGraphEdgesData(
 		const proto_transport::Graph& base_graph_data);
-	std::vector<graph::IncidenceList> DeserializeGraphIncidenceListsData(
-		const proto_transport::Graph& base_graph_data);
 	/// Router
 	void DeserializeRouterData(const proto_transport::Router& base_router);
-	std::optional<graph::Router<double>::RouteInternalData> DeserializeRouteInternalData(
-		proto_transport::RouteInternalDataVectorElem& base);
+	/// Contraction hierarchy
+	void DeserializeContractionHierarchyData(
+		const proto_transport::ContractionHierarchy& base_hierarchy);
+	/// Hub labels
+	void DeserializeHubLabelsData(const proto_transport::HubLabels& base_labels);
+	void DeserializeHubLabelSetData(const proto_transport::HubLabelSet& base_set,
+									graph::HubLabels<double>::LabelSet& set);
+	/// Partial router
+	void DeserializePartialRouterData(const proto_transport::PartialRouter& base_partial);
+	/// Multi-level overlay
+	void DeserializeOverlayData(const proto_transport::MultiLevelOverlay& base_overlay);
+	/// ALT landmarks
+	void DeserializeLandmarksData(const proto_transport::Landmarks& base_landmarks);
+	/// Reachability components, found again if the base has none
+	void DeserializeComponentsData(const proto_transport::Components& base_components);
+	/// Make_base estimates
+	void DeserializeStatisticsData(const proto_transport::RouterStatistics& base_statistics);
 
   private:
 	transport::SerializationSettings settings_;
@@ -1,9 +1,36 @@
 #include "transport_router.h"
 
+namespace transport {
+  using namespace std::literals;
+
+  std::string_view GetRouterEngineName(RouterEngine engine) {
+	switch (engine) {
+	  case RouterEngine::FLOYD_WARSHALL:
+		return "floyd_warshall"sv;
+	  case RouterEngine::DIJKSTRA:
+		return "dijkstra"sv;
+	  case RouterEngine::CONTRACTION_HIERARCHY:
+		return "contraction_hierarchy"sv;
+	  case RouterEngine::RAPTOR:
+		return "raptor"sv;
+	  case RouterEngine::A_STAR:
+		return "a_star"sv;
+	  case RouterEngine::HUB_LABELS:
+		return "hub_labels"sv;
+	  case RouterEngine::PARTIAL:
+		return "partial"sv;
+	  case RouterEngine::OVERLAY:
+		return "overlay"sv;
+	}
+	return {};
+  }
+}  // namespace transport
+
 namespace transport_router {
   using namespace transport;
   void TransportRouter::SetSettings(const RouterSettings& settings) {
 	settings_ = settings;
+	route_cache_.SetCapacity(std::max(settings_.route_cache_size, 0));
   }
 
   RouterSettings TransportRouter::GetSettings() const {
@@ -18,29 +45,892 @@ namespace transport_router {
 	return graph_;
   }
 
+  bool TransportRouter::UsesFixedPointWeights() const {
+	return settings_.fixed_point_weights
+		   && (settings_.engine == RouterEngine::FLOYD_WARSHALL
+			   || settings_.engine == RouterEngine::DIJKSTRA);
+  }
+
+  /// A shortest route leaves every vertex at most once, so it is not longer than
+  /// the sum of the heaviest edges leaving the vertices; twice that must fit
+  /// below the missing route, the routers add two route weights.
+  void TransportRouter::BuildFixedPointGraph() {
+	fixed_graph_ = {};
+	if (!UsesFixedPointWeights() || !graph_.IsFrozen()) {
+	  return;
+	}
+	const uint64_t wait_weight = static_cast<uint64_t>(std::max(settings_.bus_wait_time, 0))
+								 * static_cast<uint64_t>(GetFixedPointScale());
+	std::vector<uint64_t> max_weights(graph_.GetVertexCount(), 0);
+	std::vector<graph::Edge<FixedWeight>>& fixed_edges = fixed_graph_.ModifyEdges();
+	fixed_edges.reserve(graph_.GetEdgeCount());
+	for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+	  const auto& edge = graph_.GetEdge(edge_id);
+	  const Edges& data = edges_.at(edge_id);
+	  if (settings_.bus_wait_time < 0 || data.distance < 0) {
+		throw std::domain_error("Edges' weights should be non-negative");
+	  }
+	  uint64_t weight
+		  = data.type == edge_type::WAIT ? wait_weight : 3 * static_cast<uint64_t>(data.distance);
+	  if (data.type == edge_type::BUS && settings_.single_vertex_stops) {
+		weight += wait_weight;
+	  }
+	  max_weights[edge.from] = std::max(max_weights[edge.from], weight);
+	  fixed_edges.push_back({edge.from, edge.to, static_cast<FixedWeight>(weight)});
+	}
+	const uint64_t max_route_weight
+		= std::accumulate(max_weights.begin(), max_weights.end(), uint64_t {0});
+	if (max_route_weight >= std::numeric_limits<FixedWeight>::max() / 2) {
+	  fixed_graph_ = {};
+	  throw std::length_error("Routes are too long for fixed-point weights");
+	}
+	fixed_graph_.ModifyOffsets() = graph_.GetOffsets();
+  }
+
   void TransportRouter::GenerateRouter() {
-	if (router_ != nullptr) {
-	  router_.release();
+	if (settings_.auto_engine || settings_.engine != RouterEngine::RAPTOR) {
+	  AddStops();
+	  AddEdges();
+	  FreezeGraph();
+	  FindComponents();
+	}
+	if (settings_.auto_engine) {
+	  settings_.engine = PickEngine();
+	}
+	statistics_ = EstimateEngine(settings_.engine);
+	statistics_.auto_engine = settings_.auto_engine;
+	CheckBudgets(settings_.engine, statistics_);
+	CreateRouter();
+	if (settings_.engine == RouterEngine::A_STAR) {
+	  EnableLowerBound();
 	}
-	AddStops();
-	AddEdges();
-	router_ = std::make_unique<graph::Router<double>>(graph::Router(graph_));
   }
 
   void TransportRouter::GenerateEmptyRouter() {
-	if (router_ != nullptr) {
-	  router_.release();
+	CreateRouter();
+  }
+
+  void TransportRouter::CreateRouter() {
+	route_cache_.Clear();
+	const size_t thread_count = parallel::ResolveThreadCount(std::max(settings_.threads, 0));
+	switch (settings_.engine) {
+	  case RouterEngine::FLOYD_WARSHALL:
+		if (UsesFixedPointWeights()) {
+		  BuildFixedPointGraph();
+		  router_ = std::make_unique<graph::Router<FixedWeight>>(fixed_graph_, thread_count);
+		} else if (settings_.float_weights) {
+		  router_ = std::make_unique<graph::Router<double, float>>(graph_, thread_count);
+		} else {
+		  router_ = std::make_unique<graph::Router<double>>(graph_, thread_count);
+		}
+		break;
+	  case RouterEngine::DIJKSTRA:
+		if (UsesFixedPointWeights()) {
+		  BuildFixedPointGraph();
+		  router_ = std::make_unique<graph::DijkstraRouter<FixedWeight>>(fixed_graph_);
+		} else {
+		  router_ = std::make_unique<graph::DijkstraRouter<double>>(graph_);
+		}
+		break;
+	  case RouterEngine::A_STAR:
+		router_ = std::make_unique<graph::DijkstraRouter<double>>(graph_);
+		landmarks_ = graph::Landmarks<double>(graph_, std::max(settings_.landmark_count, 0),
+											  thread_count);
+		break;
+	  case RouterEngine::CONTRACTION_HIERARCHY:
+		router_ = std::make_unique<graph::ContractionHierarchy<double>>(graph_);
+		break;
+	  case RouterEngine::HUB_LABELS:
+		router_ = std::make_unique<graph::HubLabels<double>>(graph_);
+		break;
+	  case RouterEngine::PARTIAL:
+		router_ = std::make_unique<graph::PartialRouter<double>>(
+			graph_, GetHotStopVertexes(), std::max(settings_.promote_after, 0), thread_count);
+		break;
+	  case RouterEngine::OVERLAY:
+		router_ = std::make_unique<graph::MultiLevelOverlay<double>>(graph_, PartitionVertexes());
+		break;
+	  case RouterEngine::RAPTOR:
+		router_ = std::make_unique<RaptorRouter>(catalogue_, settings_.bus_wait_time * 1.0,
+												 settings_.bus_velocity_kmh * 1000.0 / 60.0);
+		break;
 	}
-	router_ = std::make_unique<graph::Router<double>>(graph::Router(graph_));
   }
 
-  std::unique_ptr<graph::Router<double>>& TransportRouter::ModifyRouter() {
+  void TransportRouter::FindComponents() {
+	components_ = graph_.IsFrozen() ? graph::Components(graph_) : graph::Components {};
+  }
+
+  /// Rough figures from the sizes of the structures and the work of their
+  /// builds, at the rates of one core of a current desktop: the tiled table
+  /// relaxes about 2e9 entries a second, the searches about 5e7 edges.
+  RouterStatistics TransportRouter::EstimateEngine(RouterEngine engine) const {
+	constexpr double TABLE_RELAXATIONS_PER_SECOND = 2e9;
+	constexpr double SEARCH_RELAXATIONS_PER_SECOND = 5e7;
+	constexpr double MAP_NODE_BYTES = 48.0;	 /// std::map node overhead
+
+	RouterStatistics statistics;
+	if (engine == RouterEngine::RAPTOR) {
+	  double bus_stops = 0.0;
+	  for (const auto& [name, bus] : catalogue_.GetRoutesForRender()) {
+		bus_stops += static_cast<double>(bus.stops.size());
+	  }
+	  const double stops = static_cast<double>(catalogue_.GetStopsForRender().size());
+	  /// stop ids and the times of the lines, the routes of the stops
+	  statistics.memory_bytes
+		  = static_cast<uint64_t>(bus_stops * 3 * sizeof(double) + stops * MAP_NODE_BYTES);
+	  statistics.build_seconds = bus_stops / SEARCH_RELAXATIONS_PER_SECOND;
+	  return statistics;
+	}
+
+	statistics.vertex_count = graph_.GetVertexCount();
+	statistics.edge_count = graph_.GetEdgeCount();
+	const double vertexes = static_cast<double>(statistics.vertex_count);
+	const double edges = static_cast<double>(statistics.edge_count);
+	const double degree = vertexes > 0.0 ? edges / vertexes : 0.0;
+	/// one search over the whole graph
+	const double search
+		= edges * std::log2(std::max(vertexes, 2.0)) / SEARCH_RELAXATIONS_PER_SECOND;
+	const bool fixed_point = settings_.fixed_point_weights
+							 && (engine == RouterEngine::FLOYD_WARSHALL
+								 || engine == RouterEngine::DIJKSTRA);
+
+	double memory = edges * (sizeof(graph::Edge<double>) + sizeof(Edges))
+					+ vertexes * (sizeof(graph::EdgeId) + sizeof(std::optional<std::string_view>))
+					+ static_cast<double>(vertexes_.size()) * (sizeof(StopAsVertexes) + MAP_NODE_BYTES);
+	double seconds = edges / SEARCH_RELAXATIONS_PER_SECOND;
+	double parallel_seconds = 0.0;
+	if (fixed_point) {
+	  memory += edges * sizeof(graph::Edge<FixedWeight>);
+	}
+	switch (engine) {
+	  case RouterEngine::FLOYD_WARSHALL: {
+		const double weight_size = fixed_point				  ? sizeof(FixedWeight)
+								   : settings_.float_weights ? sizeof(float)
+															  : sizeof(double);
+		memory += vertexes * vertexes * (weight_size + sizeof(graph::CompactEdgeId));
+		parallel_seconds = vertexes * vertexes * vertexes / TABLE_RELAXATIONS_PER_SECOND;
+		break;
+	  }
+	  case RouterEngine::DIJKSTRA:
+		break;
+	  case RouterEngine::A_STAR: {
+		/// weights from and to every landmark, a search each way per landmark
+		const double landmarks
+			= std::min(static_cast<double>(std::max(settings_.landmark_count, 0)), vertexes);
+		memory += 2 * landmarks * vertexes * sizeof(double);
+		parallel_seconds = 2 * landmarks * search;
+		break;
+	  }
+	  case RouterEngine::CONTRACTION_HIERARCHY:
+		/// as many shortcuts as edges, a witness search of about degree^2 edges
+		/// between every pair of neighbours of a contracted vertex
+		memory += 2 * edges
+				  * (sizeof(graph::ContractionHierarchy<double>::HierarchyEdge)
+					 + 2 * sizeof(graph::EdgeId));
+		seconds += vertexes * degree * degree * degree * std::log2(std::max(vertexes, 2.0))
+				   / SEARCH_RELAXATIONS_PER_SECOND;
+		break;
+	  case RouterEngine::HUB_LABELS: {
+		/// labels of about the square root of the vertices each way, a pruned
+		/// search per vertex
+		const double entries = 2 * vertexes * std::sqrt(vertexes);
+		memory += entries * (sizeof(graph::HubLabels<double>::HubRank) + sizeof(double)
+							 + sizeof(graph::EdgeId));
+		seconds += entries * degree * std::log2(std::max(vertexes, 2.0))
+				   / SEARCH_RELAXATIONS_PER_SECOND;
+		break;
+	  }
+	  case RouterEngine::PARTIAL: {
+		const double trees
+			= std::min(static_cast<double>(settings_.hot_stops.size()), vertexes);
+		memory += trees * vertexes * (sizeof(double) + sizeof(graph::EdgeId));
+		parallel_seconds = trees * search;
+		break;
+	  }
+	  case RouterEngine::OVERLAY: {
+		/// per level, cliques of about 16 boundary vertices per cell of
+		/// cell_size stops, searched from every boundary vertex within its cell
+		const double levels = std::max(settings_.overlay_levels, 1);
+		const double cell_size = std::max(settings_.overlay_cell_size, 1);
+		memory += levels * 16 * vertexes * (sizeof(double) + sizeof(graph::VertexId));
+		seconds += levels * edges * std::sqrt(cell_size) * std::log2(std::max(vertexes, 2.0))
+				   / SEARCH_RELAXATIONS_PER_SECOND;
+		break;
+	  }
+	  case RouterEngine::RAPTOR:
+		break;
+	}
+	statistics.memory_bytes = static_cast<uint64_t>(memory);
+	statistics.build_seconds = seconds + parallel_seconds;
+	statistics.parallel_seconds = parallel_seconds;
+	return statistics;
+  }
+
+  /// Wall time of the build on the make_base threads.
+  double TransportRouter::GetBuildTime(const RouterStatistics& statistics) const {
+	const double threads
+		= static_cast<double>(parallel::ResolveThreadCount(std::max(settings_.threads, 0)));
+	return statistics.build_seconds - statistics.parallel_seconds
+		   + statistics.parallel_seconds / threads;
+  }
+
+  bool TransportRouter::IsWithinBudgets(const RouterStatistics& statistics) const {
+	const uint64_t memory_budget = static_cast<uint64_t>(std::max(settings_.memory_budget_mb, 0))
+								   * 1024 * 1024;
+	return (memory_budget == 0 || statistics.memory_bytes <= memory_budget)
+		   && (settings_.build_time_budget_s <= 0
+			   || GetBuildTime(statistics) <= settings_.build_time_budget_s);
+  }
+
+  /// The graph engines in the order of their query speed; the partial engine
+  /// depends on the hot stops and the raptor one has no graph, neither is picked.
+  RouterEngine TransportRouter::PickEngine() const {
+	constexpr RouterEngine ENGINES[] = {RouterEngine::FLOYD_WARSHALL, RouterEngine::HUB_LABELS,
+										RouterEngine::CONTRACTION_HIERARCHY,
+										RouterEngine::OVERLAY, RouterEngine::A_STAR,
+										RouterEngine::DIJKSTRA};
+	for (const RouterEngine engine : ENGINES) {
+	  if (IsWithinBudgets(EstimateEngine(engine))) {
+		return engine;
+	  }
+	}
+	return RouterEngine::DIJKSTRA;
+  }
+
+  void TransportRouter::CheckBudgets(RouterEngine engine,
+									 const RouterStatistics& statistics) const {
+	if (IsWithinBudgets(statistics)) {
+	  return;
+	}
+	std::ostringstream message;
+	message << std::fixed << std::setprecision(1) << GetRouterEngineName(engine)
+			<< " router needs about "sv << statistics.memory_bytes / (1024.0 * 1024.0)
+			<< " MB and "sv << GetBuildTime(statistics) << " s to build for "sv
+			<< statistics.vertex_count << " vertices and "sv << statistics.edge_count
+			<< " edges, over the budget of "sv;
+	if (settings_.memory_budget_mb > 0) {
+	  message << settings_.memory_budget_mb << " MB"sv;
+	}
+	if (settings_.memory_budget_mb > 0 && settings_.build_time_budget_s > 0) {
+	  message << " and "sv;
+	}
+	if (settings_.build_time_budget_s > 0) {
+	  message << settings_.build_time_budget_s << " s"sv;
+	}
+	throw std::length_error(message.str());
+  }
+
+  std::vector<graph::VertexId> TransportRouter::GetHotStopVertexes() const {
+	std::vector<graph::VertexId> vertexes;
+	for (const std::string& stop : settings_.hot_stops) {
+	  if (const auto it = vertexes_.find(stop); it != vertexes_.end()) {
+		vertexes.push_back(it->second.in.id);
+	  }
+	}
+	return vertexes;
+  }
+
+  graph::MultiLevelOverlay<double>::Partition TransportRouter::PartitionVertexes() const {
+	using CellId = graph::MultiLevelOverlay<double>::CellId;
+	std::vector<std::pair<std::string_view, geo::Coordinates>> stops;
+	stops.reserve(vertexes_.size());
+	for (const auto& [name, data] : vertexes_) {
+	  stops.emplace_back(name, catalogue_.SearchStop(name)->geo);
+	}
+	const size_t cell_size = std::max(settings_.overlay_cell_size, 1);
+	size_t depth = 0;
+	while ((stops.size() >> depth) > cell_size) {
+	  ++depth;
+	}
+	/// each level above the finest merges 4 cells, at least 2 cells are left
+	const size_t level_count
+		= depth == 0 ? 0 : std::min<size_t>(std::max(settings_.overlay_levels, 1), (depth + 1) / 2);
+
+	/// finest cell of every stop: the bits of the halves it falls in
+	std::vector<CellId> stop_cells(stops.size(), 0);
+	std::vector<size_t> order(stops.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::function<void(size_t, size_t, size_t)> halve
+		= [&](size_t begin, size_t end, size_t halvings) {
+			if (halvings == 0 || end - begin < 2) {
+			  return;
+			}
+			auto [lat_min, lat_max] = std::minmax_element(
+				order.begin() + begin, order.begin() + end, [&stops](size_t lhs, size_t rhs) {
+				  return stops[lhs].second.lat < stops[rhs].second.lat;
+				});
+			auto [lng_min, lng_max] = std::minmax_element(
+				order.begin() + begin, order.begin() + end, [&stops](size_t lhs, size_t rhs) {
+				  return stops[lhs].second.lng < stops[rhs].second.lng;
+				});
+			const bool by_lat = stops[*lat_max].second.lat - stops[*lat_min].second.lat
+								>= stops[*lng_max].second.lng - stops[*lng_min].second.lng;
+			const size_t middle = begin + (end - begin) / 2;
+			std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+							 [&stops, by_lat](size_t lhs, size_t rhs) {
+							   const geo::Coordinates& l = stops[lhs].second;
+							   const geo::Coordinates& r = stops[rhs].second;
+							   return by_lat ? l.lat < r.lat : l.lng < r.lng;
+							 });
+			for (size_t i = begin; i < end; ++i) {
+			  stop_cells[order[i]] = stop_cells[order[i]] << 1 | (i >= middle ? 1 : 0);
+			}
+			halve(begin, middle, halvings - 1);
+			halve(middle, end, halvings - 1);
+		  };
+	halve(0, stops.size(), depth);
+
+	graph::MultiLevelOverlay<double>::Partition partition(
+		level_count, std::vector<CellId>(graph_.GetVertexCount(), 0));
+	for (size_t i = 0; i < stops.size(); ++i) {
+	  const StopAsVertexes& vertexes = vertexes_.at(stops[i].first);
+	  for (size_t level = 0; level < level_count; ++level) {
+		const CellId cell = stop_cells[i] >> (2 * level);
+		partition[level][vertexes.in.id] = cell;
+		partition[level][vertexes.out.id] = cell;
+	  }
+	}
+	return partition;
+  }
+
+  const RouterVariant& TransportRouter::GetRouterVariant() const {
 	return router_;
   }
 
-  std::optional<TransportRouter::RouteData> TransportRouter::GetRoute(
-	  std::string_view from, std::string_view to) {
-	return router_->BuildRoute(vertexes_.at(from).in.id, vertexes_.at(to).in.id);
+  bool TransportRouter::EnableLowerBound() {
+	auto& router = std::get<std::unique_ptr<graph::DijkstraRouter<double>>>(router_);
+	const bool use_straight_lines = RoadsAreNotShorterThanStraightLines();
+	const bool use_landmarks = !landmarks_.GetLandmarkData().landmarks.empty();
+	if (!use_straight_lines && !use_landmarks) {
+	  router->SetLowerBound({});
+	  return false;
+	}
+	vertex_coordinates_.assign(graph_.GetVertexCount(), {});
+	for (const auto& [name, data] : vertexes_) {
+	  const geo::Coordinates coordinates = catalogue_.SearchStop(name)->geo;
+	  vertex_coordinates_[data.in.id] = coordinates;
+	  vertex_coordinates_[data.out.id] = coordinates;
+	}
+	const double velocity = settings_.bus_velocity_kmh * 1000.0 / 60.0;
+	router->SetLowerBound([this, velocity, use_straight_lines, use_landmarks](
+							  graph::VertexId vertex, graph::VertexId to) {
+	  const double bound = use_landmarks ? landmarks_.GetLowerBound(vertex, to) : 0.0;
+	  if (!use_straight_lines || !std::isfinite(bound)) {
+		return bound;
+	  }
+	  const double distance
+		  = geo::ComputeDistance(vertex_coordinates_[vertex], vertex_coordinates_[to]);
+	  /// acos of a rounded cosine above 1 gives nan for coinciding stops
+	  return std::isfinite(distance) ? std::max(bound, distance / velocity) : bound;
+	});
+	return true;
+  }
+
+  /// Rides over several stops are bounded too: the road is at least the sum of
+  /// straight lines, which is at least the straight line between the ends.
+  bool TransportRouter::RoadsAreNotShorterThanStraightLines() const {
+	const auto& distances = catalogue_.GetDistForRouter();
+	for (const auto& [name, bus] : catalogue_.GetRoutesForRender()) {
+	  for (size_t i = 1; i < bus.stops.size(); ++i) {
+		const auto forward = distances.find(std::pair(bus.stops[i - 1], bus.stops[i]));
+		const int road = forward != distances.end()
+							 ? forward->second
+							 : distances.at(std::pair(bus.stops[i], bus.stops[i - 1]));
+		if (road < geo::ComputeDistance(catalogue_.SearchStop(bus.stops[i - 1])->geo,
+										catalogue_.SearchStop(bus.stops[i])->geo)) {
+		  return false;
+		}
+	  }
+	}
+	return true;
+  }
+
+  std::shared_ptr<const RouteData> TransportRouter::GetRoute(std::string_view from,
+															 std::string_view to) {
+	/// a stop left out of the graph has no vertex for the key
+	const bool cacheable = settings_.engine == RouterEngine::RAPTOR
+						   || (vertexes_.count(from) && vertexes_.count(to));
+	const RouteKey key = cacheable ? GetRouteKey(from, to) : RouteKey {};
+	if (cacheable) {
+	  if (auto cached_route = route_cache_.Find(key)) {
+		return *cached_route;
+	  }
+	}
+	std::optional<RouteData> route_data = std::visit(
+		[this, from, to](const auto& router) { return BuildRoute(*router, from, to); },
+		router_);
+	std::shared_ptr<const RouteData> route;
+	if (route_data) {
+	  route = std::make_shared<const RouteData>(std::move(*route_data));
+	}
+	if (cacheable) {
+	  route_cache_.Insert(key, route);
+	}
+	return route;
+  }
+
+  std::shared_ptr<const RouteData> TransportRouter::GetRoute(std::string_view from,
+															 std::string_view to,
+															 const RouterSettings& settings) {
+	if (settings.bus_wait_time == settings_.bus_wait_time
+		&& settings.bus_velocity_kmh == settings_.bus_velocity_kmh) {
+	  return GetRoute(from, to);
+	}
+	if (settings.bus_wait_time < 0 || settings.bus_velocity_kmh <= 0) {
+	  throw std::invalid_argument("Wait time should be non-negative and velocity positive");
+	}
+	std::optional<RouteData> route_data;
+	if (settings_.engine == RouterEngine::RAPTOR) {
+	  const RaptorRouter router(catalogue_, settings.bus_wait_time * 1.0,
+								settings.bus_velocity_kmh * 1000.0 / 60.0);
+	  route_data = BuildRoute(router, from, to);
+	} else {
+	  graph::DijkstraRouter<double> router(graph_);
+	  router.SetEdgeWeight([this, &settings](graph::EdgeId edge_id) {
+		const double time = CalculateTime(edges_[edge_id], settings);
+		return settings_.single_vertex_stops ? settings.bus_wait_time + time : time;
+	  });
+	  route_data = vertexes_.count(from) && vertexes_.count(to)
+					   ? BuildRoute(router, from, to)
+					   : BuildCompactedRoute(router, from, to, settings);
+	  if (route_data) {
+		for (Edges& item : route_data->items) {
+		  item.time = CalculateTime(item, settings);
+		}
+	  }
+	}
+	if (!route_data) {
+	  return nullptr;
+	}
+	return std::make_shared<const RouteData>(std::move(*route_data));
+  }
+
+  const RouteCache& TransportRouter::GetRouteCache() const {
+	return route_cache_;
+  }
+
+  RouteKey TransportRouter::GetRouteKey(std::string_view from, std::string_view to) const {
+	if (const auto* raptor = std::get_if<std::unique_ptr<RaptorRouter>>(&router_)) {
+	  return {(*raptor)->GetStopId(from), (*raptor)->GetStopId(to)};
+	}
+	return {vertexes_.at(from).in.id, vertexes_.at(to).in.id};
+  }
+
+  double TransportRouter::GetFixedPointScale() const {
+	return 50.0 * settings_.bus_velocity_kmh;
+  }
+
+  template <typename Weight>
+  double TransportRouter::ToMinutes(Weight weight) const {
+	if constexpr (std::is_integral_v<Weight>) {
+	  return weight / GetFixedPointScale();
+	} else {
+	  return weight;
+	}
+  }
+
+  /// The time of a stop within max_time may be rounded up in minutes, the
+  /// slack keeps it in.
+  template <typename Weight>
+  Weight TransportRouter::FromMinutes(double max_time) const {
+	if constexpr (std::is_integral_v<Weight>) {
+	  const double weight = std::floor(max_time * GetFixedPointScale() + 1e-6);
+	  const double max_weight = std::numeric_limits<Weight>::max() - 1.0;
+	  return static_cast<Weight>(std::min(weight, max_weight));
+	} else {
+	  return max_time;
+	}
+  }
+
+  template <typename Router>
+  std::optional<RouteData> TransportRouter::BuildRoute(const Router& router,
+													   std::string_view from,
+													   std::string_view to) const {
+	const auto from_vertexes = vertexes_.find(from);
+	const auto to_vertexes = vertexes_.find(to);
+	if (from_vertexes == vertexes_.end() || to_vertexes == vertexes_.end()) {
+	  return BuildCompactedRoute(router, from, to, settings_);
+	}
+	return BuildVertexRoute(router, from_vertexes->second.in.id, to_vertexes->second.in.id);
+  }
+
+  template <typename Router>
+  std::optional<RouteData> TransportRouter::BuildVertexRoute(const Router& router,
+															 graph::VertexId from,
+															 graph::VertexId to) const {
+	if (!components_.MayReach(from, to)) {
+	  return std::nullopt;
+	}
+	const auto route_info = router.BuildRoute(from, to);
+	if (!route_info) {
+	  return std::nullopt;
+	}
+	RouteData route {ToMinutes(route_info->weight), {}};
+	route.items.reserve(route_info->edges.size() * 2);
+	for (const graph::EdgeId edge_id : route_info->edges) {
+	  if (settings_.single_vertex_stops) {
+		route.items.push_back({edge_type::WAIT, *vertex_stops_.at(graph_.GetEdge(edge_id).from),
+							   settings_.bus_wait_time * 1.0, 0, 0, {}});
+	  }
+	  route.items.push_back(edges_.at(edge_id));
+	}
+	return route;
+  }
+
+  std::optional<RouteData> TransportRouter::BuildRoute(const RaptorRouter& router,
+													   std::string_view from,
+													   std::string_view to) const {
+	const auto route_info = router.BuildRoute(from, to);
+	if (!route_info) {
+	  return std::nullopt;
+	}
+	RouteData route {route_info->weight, {}};
+	route.items.reserve(route_info->rides.size() * 2);
+	for (const RaptorRouter::Ride& ride : route_info->rides) {
+	  route.items.push_back({edge_type::WAIT, ride.stop, router.GetBusWaitTime(), 0, 0, {}});
+	  route.items.push_back({edge_type::BUS, ride.bus, ride.time, ride.span_count, 0, {}});
+	}
+	return route;
+  }
+
+  bool TransportRouter::IsGraphStop(const Stop& stop) const {
+	if (!settings_.compact_graph || stop.buses.size() > 1) {
+	  return true;
+	}
+	if (stop.buses.empty()) {
+	  return false;
+	}
+	const Bus& bus = *catalogue_.SearchRoute(*stop.buses.begin());
+	return !bus.is_round_trip || std::count(bus.stops.begin(), bus.stops.end(), stop.name) != 1;
+  }
+
+  std::vector<TransportRouter::StopAccess> TransportRouter::GetStopAccesses(
+	  std::string_view stop, bool from_stop, const RouterSettings& settings) const {
+	if (const auto it = vertexes_.find(stop); it != vertexes_.end()) {
+	  return {{it->second.in.id, 0.0, {}}};
+	}
+	const Stop* stop_data = catalogue_.SearchStop(stop);
+	if (stop_data == nullptr) {
+	  throw std::out_of_range("Unknown stop: "s + std::string(stop));
+	}
+	std::vector<StopAccess> accesses;
+	if (stop_data->buses.empty()) {
+	  return accesses;
+	}
+	const Bus& bus = *catalogue_.SearchRoute(*stop_data->buses.begin());
+	const size_t index
+		= std::find(bus.stops.begin(), bus.stops.end(), stop_data->name) - bus.stops.begin();
+	ForEachRide(bus, [&](size_t from, size_t to, int distance, size_t span) {
+	  if ((from_stop ? from : to) != index) {
+		return;
+	  }
+	  const auto other = vertexes_.find(bus.stops[from_stop ? to : from]);
+	  if (other == vertexes_.end()) {
+		return;
+	  }
+	  const Edges wait {edge_type::WAIT, bus.stops[from], settings_.bus_wait_time * 1.0, 0, 0, {}};
+	  const Edges ride {edge_type::BUS, bus.name, CalculateWeight(distance), span, distance, {}};
+	  accesses.push_back({other->second.in.id,
+						  CalculateTime(wait, settings) + CalculateTime(ride, settings),
+						  {wait, ride}});
+	});
+	return accesses;
+  }
+
+  std::optional<RouteData> TransportRouter::GetDirectRide(std::string_view from,
+														  std::string_view to,
+														  const RouterSettings& settings) const {
+	if (vertexes_.count(from) || vertexes_.count(to)) {
+	  return std::nullopt;
+	}
+	const Stop* from_stop = catalogue_.SearchStop(from);
+	const Stop* to_stop = catalogue_.SearchStop(to);
+	if (from_stop == nullptr || to_stop == nullptr || from_stop->buses.empty()
+		|| from_stop->buses != to_stop->buses) {
+	  return std::nullopt;
+	}
+	const Bus& bus = *catalogue_.SearchRoute(*from_stop->buses.begin());
+	const auto position = [&bus](std::string_view stop) {
+	  return static_cast<size_t>(std::find(bus.stops.begin(), bus.stops.end(), stop)
+								 - bus.stops.begin());
+	};
+	const size_t from_index = position(from_stop->name);
+	const size_t to_index = position(to_stop->name);
+	std::optional<RouteData> route;
+	ForEachRide(bus, [&](size_t ride_from, size_t ride_to, int distance, size_t span) {
+	  if (ride_from != from_index || ride_to != to_index) {
+		return;
+	  }
+	  const Edges wait {edge_type::WAIT, from_stop->name, settings_.bus_wait_time * 1.0, 0, 0, {}};
+	  const Edges ride {edge_type::BUS, bus.name, CalculateWeight(distance), span, distance, {}};
+	  route = RouteData {CalculateTime(wait, settings) + CalculateTime(ride, settings),
+						 {wait, ride}};
+	});
+	return route;
+  }
+
+  template <typename Router>
+  std::vector<std::optional<double>> TransportRouter::BuildAccessTimes(
+	  const Router& router, const std::vector<StopAccess>& sources,
+	  const std::vector<StopAccess>& targets) const {
+	if (sources.empty() || targets.empty()) {
+	  return std::vector<std::optional<double>>(sources.size() * targets.size());
+	}
+	std::vector<graph::VertexId> source_vertexes;
+	source_vertexes.reserve(sources.size());
+	for (const StopAccess& source : sources) {
+	  source_vertexes.push_back(source.vertex);
+	}
+	std::vector<graph::VertexId> target_vertexes;
+	target_vertexes.reserve(targets.size());
+	for (const StopAccess& target : targets) {
+	  target_vertexes.push_back(target.vertex);
+	}
+	const auto weights = router.BuildWeights(source_vertexes, target_vertexes);
+	std::vector<std::optional<double>> times(weights.size());
+	for (size_t i = 0; i < weights.size(); ++i) {
+	  if (weights[i]) {
+		times[i] = sources[i / targets.size()].time + ToMinutes(*weights[i])
+				   + targets[i % targets.size()].time;
+	  }
+	}
+	return times;
+  }
+
+  /// The direct ride of the bus or the fastest pair of accesses, the route
+  /// between their vertices is searched after.
+  template <typename Router>
+  std::optional<RouteData> TransportRouter::BuildCompactedRoute(
+	  const Router& router, std::string_view from, std::string_view to,
+	  const RouterSettings& settings) const {
+	const std::vector<StopAccess> sources = GetStopAccesses(from, true, settings);
+	const std::vector<StopAccess> targets = GetStopAccesses(to, false, settings);
+	if (from == to) {
+	  return RouteData {0.0, {}};
+	}
+	std::optional<RouteData> route = GetDirectRide(from, to, settings);
+	const std::vector<std::optional<double>> times = BuildAccessTimes(router, sources, targets);
+	size_t best = times.size();
+	for (size_t i = 0; i < times.size(); ++i) {
+	  if (times[i] && (!route || *times[i] < route->weight)
+		  && (best == times.size() || *times[i] < *times[best])) {
+		best = i;
+	  }
+	}
+	if (best == times.size()) {
+	  return route;
+	}
+	const StopAccess& source = sources[best / targets.size()];
+	const StopAccess& target = targets[best % targets.size()];
+	const std::optional<RouteData> between = BuildVertexRoute(router, source.vertex, target.vertex);
+	if (!between) {
+	  return route;
+	}
+	route = RouteData {source.time + between->weight + target.time, source.items};
+	route->items.insert(route->items.end(), between->items.begin(), between->items.end());
+	route->items.insert(route->items.end(), target.items.begin(), target.items.end());
+	return route;
+  }
+
+  /// One search over the accesses of all the stops, each pair takes the fastest
+  /// of theirs.
+  template <typename Router>
+  std::vector<std::optional<double>> TransportRouter::BuildCompactedWeights(
+	  const Router& router, const std::vector<std::string_view>& sources,
+	  const std::vector<std::string_view>& targets) const {
+	auto collect = [this](const std::vector<std::string_view>& stops, bool from_stop,
+						  std::vector<StopAccess>& accesses) {
+	  std::vector<size_t> offsets {0};
+	  for (const std::string_view stop : stops) {
+		std::vector<StopAccess> stop_accesses = GetStopAccesses(stop, from_stop, settings_);
+		std::move(stop_accesses.begin(), stop_accesses.end(), std::back_inserter(accesses));
+		offsets.push_back(accesses.size());
+	  }
+	  return offsets;
+	};
+	std::vector<StopAccess> source_accesses;
+	std::vector<StopAccess> target_accesses;
+	const std::vector<size_t> source_offsets = collect(sources, true, source_accesses);
+	const std::vector<size_t> target_offsets = collect(targets, false, target_accesses);
+	const std::vector<std::optional<double>> access_times
+		= BuildAccessTimes(router, source_accesses, target_accesses);
+
+	std::vector<std::optional<double>> times;
+	times.reserve(sources.size() * targets.size());
+	for (size_t i = 0; i < sources.size(); ++i) {
+	  for (size_t j = 0; j < targets.size(); ++j) {
+		std::optional<double>& time = times.emplace_back();
+		if (sources[i] == targets[j]) {
+		  time = 0.0;
+		  continue;
+		}
+		if (const auto ride = GetDirectRide(sources[i], targets[j], settings_)) {
+		  time = ride->weight;
+		}
+		for (size_t source = source_offsets[i]; source < source_offsets[i + 1]; ++source) {
+		  for (size_t target = target_offsets[j]; target < target_offsets[j + 1]; ++target) {
+			const auto& access_time = access_times[source * target_accesses.size() + target];
+			if (access_time && (!time || *access_time < *time)) {
+			  time = access_time;
+			}
+		  }
+		}
+	  }
+	}
+	return times;
+  }
+
+  std::vector<std::optional<double>> TransportRouter::GetTravelTimes(
+	  const std::vector<std::string_view>& sources,
+	  const std::vector<std::string_view>& targets) {
+	return std::visit(
+		[this, &sources, &targets](const auto& router) {
+		  return BuildWeights(*router, sources, targets);
+		},
+		router_);
+  }
+
+  template <typename Router>
+  std::vector<std::optional<double>> TransportRouter::BuildWeights(
+	  const Router& router, const std::vector<std::string_view>& sources,
+	  const std::vector<std::string_view>& targets) const {
+	auto in_graph = [this](std::string_view stop) { return vertexes_.count(stop) > 0; };
+	if (!std::all_of(sources.begin(), sources.end(), in_graph)
+		|| !std::all_of(targets.begin(), targets.end(), in_graph)) {
+	  return BuildCompactedWeights(router, sources, targets);
+	}
+	auto to_vertexes = [this](const std::vector<std::string_view>& stops) {
+	  std::vector<graph::VertexId> vertexes;
+	  vertexes.reserve(stops.size());
+	  for (const std::string_view stop : stops) {
+		vertexes.push_back(vertexes_.at(stop).in.id);
+	  }
+	  return vertexes;
+	};
+	const auto weights = router.BuildWeights(to_vertexes(sources), to_vertexes(targets));
+	std::vector<std::optional<double>> times;
+	times.reserve(weights.size());
+	for (const auto& weight : weights) {
+	  times.push_back(weight ? std::optional(ToMinutes(*weight)) : std::nullopt);
+	}
+	return times;
+  }
+
+  std::vector<std::optional<double>> TransportRouter::BuildWeights(
+	  const RaptorRouter& router, const std::vector<std::string_view>& sources,
+	  const std::vector<std::string_view>& targets) const {
+	return router.BuildWeights(sources, targets);
+  }
+
+  std::vector<std::pair<std::string_view, double>> TransportRouter::GetReachableStops(
+	  std::string_view from, double max_time) {
+	if (max_time < 0.0) {
+	  return {};
+	}
+	auto stops = std::visit(
+		[this, from, max_time](const auto& router) {
+		  return BuildWeightsWithin(*router, from, max_time);
+		},
+		router_);
+	std::sort(stops.begin(), stops.end(), [](const auto& lhs, const auto& rhs) {
+	  return std::pair(lhs.second, lhs.first) < std::pair(rhs.second, rhs.first);
+	});
+	return stops;
+  }
+
+  template <typename Router>
+  std::vector<std::pair<std::string_view, double>> TransportRouter::BuildWeightsWithin(
+	  const Router& router, std::string_view from, double max_time) const {
+	using Weight = decltype(Router::RouteInfo::weight);
+	if (vertexes_.size() == catalogue_.GetStopsForRender().size()) {
+	  const auto weights
+		  = router.BuildWeightsWithin(vertexes_.at(from).in.id, FromMinutes<Weight>(max_time));
+	  std::vector<std::pair<graph::VertexId, double>> times;
+	  times.reserve(weights.size());
+	  for (const auto& [vertex, weight] : weights) {
+		times.emplace_back(vertex, ToMinutes(weight));
+	  }
+	  return GetStopsOfVertexes(times);
+	}
+
+	/// the graph is searched from every access of the stop, the stops left out
+	/// of it are reached by their accesses from the graph
+	constexpr double NO_TIME = std::numeric_limits<double>::infinity();
+	std::vector<double> vertex_times(graph_.GetVertexCount(), NO_TIME);
+	for (const StopAccess& source : GetStopAccesses(from, true, settings_)) {
+	  if (max_time < source.time) {
+		continue;
+	  }
+	  for (const auto& [vertex, weight] :
+		   router.BuildWeightsWithin(source.vertex, FromMinutes<Weight>(max_time - source.time))) {
+		vertex_times[vertex] = std::min(vertex_times[vertex], source.time + ToMinutes(weight));
+	  }
+	}
+	std::vector<std::pair<graph::VertexId, double>> times;
+	for (graph::VertexId vertex = 0; vertex < vertex_times.size(); ++vertex) {
+	  if (vertex_times[vertex] != NO_TIME) {
+		times.emplace_back(vertex, vertex_times[vertex]);
+	  }
+	}
+	std::vector<std::pair<std::string_view, double>> stops = GetStopsOfVertexes(times);
+	for (const auto& [name, stop] : catalogue_.GetStopsForRender()) {
+	  if (vertexes_.count(name)) {
+		continue;
+	  }
+	  double time = name == from ? 0.0 : NO_TIME;
+	  if (const auto ride = GetDirectRide(from, name, settings_)) {
+		time = std::min(time, ride->weight);
+	  }
+	  for (const StopAccess& target : GetStopAccesses(name, false, settings_)) {
+		time = std::min(time, vertex_times[target.vertex] + target.time);
+	  }
+	  if (time <= max_time) {
+		stops.emplace_back(name, time);
+	  }
+	}
+	return stops;
+  }
+
+  std::vector<std::pair<std::string_view, double>> TransportRouter::BuildWeightsWithin(
+	  const graph::ContractionHierarchy<double>&, std::string_view from,
+	  double max_time) const {
+	return SearchGraphWithin(from, max_time);
+  }
+
+  std::vector<std::pair<std::string_view, double>> TransportRouter::BuildWeightsWithin(
+	  const graph::HubLabels<double>&, std::string_view from, double max_time) const {
+	return SearchGraphWithin(from, max_time);
+  }
+
+  std::vector<std::pair<std::string_view, double>> TransportRouter::BuildWeightsWithin(
+	  const graph::MultiLevelOverlay<double>&, std::string_view from, double max_time) const {
+	return SearchGraphWithin(from, max_time);
+  }
+
+  /// The hierarchy, the labels and the overlay answer pairs only, the original
+  /// graph is searched instead.
+  std::vector<std::pair<std::string_view, double>> TransportRouter::SearchGraphWithin(
+	  std::string_view from, double max_time) const {
+	const graph::DijkstraRouter<double> router(graph_);
+	return BuildWeightsWithin(router, from, max_time);
+  }
+
+  std::vector<std::pair<std::string_view, double>> TransportRouter::BuildWeightsWithin(
+	  const RaptorRouter& router, std::string_view from, double max_time) const {
+	return router.BuildWeightsWithin(from, max_time);
+  }
+
+  /// Stops are reached at their IN vertices, OUT vertices are skipped.
+  std::vector<std::pair<std::string_view, double>> TransportRouter::GetStopsOfVertexes(
+	  const std::vector<std::pair<graph::VertexId, double>>& vertexes) const {
+	std::vector<std::pair<std::string_view, double>> result;
+	for (const auto& [vertex, weight] : vertexes) {
+	  if (vertex_stops_.at(vertex)) {
+		result.emplace_back(*vertex_stops_[vertex], weight);
+	  }
+	}
+	return result;
   }
 
   std::vector<Edges>& TransportRouter::ModifyEdgesData() {
@@ -58,56 +948,562 @@ namespace transport_router {
 	return &vertexes_;
   }
 
-  const graph::Router<double>::RoutesInternalData& TransportRouter::GetRouterData()
-	  const {
-	return router_.get()->GetRoutesInternalData();
+  std::unique_ptr<graph::ContractionHierarchy<double>>&
+  TransportRouter::ModifyContractionHierarchy() {
+	return std::get<std::unique_ptr<graph::ContractionHierarchy<double>>>(router_);
+  }
+
+  const graph::ContractionHierarchy<double>::HierarchyData&
+  TransportRouter::GetContractionHierarchyData() const {
+	return std::get<std::unique_ptr<graph::ContractionHierarchy<double>>>(router_)
+		->GetHierarchyData();
+  }
+
+  graph::HubLabels<double>::LabelData& TransportRouter::ModifyHubLabelData() {
+	return std::get<std::unique_ptr<graph::HubLabels<double>>>(router_)->ModifyLabelData();
+  }
+
+  const graph::HubLabels<double>::LabelData& TransportRouter::GetHubLabelData() const {
+	return std::get<std::unique_ptr<graph::HubLabels<double>>>(router_)->GetLabelData();
+  }
+
+  graph::PartialRouter<double>& TransportRouter::ModifyPartialRouter() {
+	return *std::get<std::unique_ptr<graph::PartialRouter<double>>>(router_);
+  }
+
+  const graph::PartialRouter<double>& TransportRouter::GetPartialRouter() const {
+	return *std::get<std::unique_ptr<graph::PartialRouter<double>>>(router_);
+  }
+
+  graph::MultiLevelOverlay<double>::OverlayData& TransportRouter::ModifyOverlayData() {
+	return std::get<std::unique_ptr<graph::MultiLevelOverlay<double>>>(router_)
+		->ModifyOverlayData();
+  }
+
+  const graph::MultiLevelOverlay<double>::OverlayData& TransportRouter::GetOverlayData() const {
+	return std::get<std::unique_ptr<graph::MultiLevelOverlay<double>>>(router_)
+		->GetOverlayData();
+  }
+
+  graph::Landmarks<double>::LandmarkData& TransportRouter::ModifyLandmarkData() {
+	return landmarks_.ModifyLandmarkData();
+  }
+
+  const graph::Landmarks<double>::LandmarkData& TransportRouter::GetLandmarkData() const {
+	return landmarks_.GetLandmarkData();
+  }
+
+  RouterStatistics& TransportRouter::ModifyStatistics() {
+	return statistics_;
+  }
+
+  const RouterStatistics& TransportRouter::GetStatistics() const {
+	return statistics_;
+  }
+
+  graph::Components::ComponentData& TransportRouter::ModifyComponentData() {
+	return components_.ModifyComponentData();
+  }
+
+  const graph::Components::ComponentData& TransportRouter::GetComponentData() const {
+	return components_.GetComponentData();
+  }
+
+  uint64_t TransportRouter::GetHilbertIndex(uint32_t x, uint32_t y, int order) {
+	const uint32_t side = uint32_t {1} << order;
+	uint64_t index = 0;
+	for (uint32_t half = side / 2; half > 0; half /= 2) {
+	  const uint32_t right = (x & half) > 0 ? 1 : 0;
+	  const uint32_t top = (y & half) > 0 ? 1 : 0;
+	  index += static_cast<uint64_t>(half) * half * ((3 * right) ^ top);
+	  /// the quadrant is turned so that the curve inside it starts and ends
+	  /// next to the neighbouring quadrants
+	  if (top == 0) {
+		if (right == 1) {
+		  x = side - 1 - x;
+		  y = side - 1 - y;
+		}
+		std::swap(x, y);
+	  }
+	}
+	return index;
+  }
+
+  std::vector<std::string_view> TransportRouter::GetGraphStopsAlongCurve() const {
+	std::vector<const Stop*> stops;
+	for (const auto& [name, stop] : catalogue_.GetStopsForRender()) {
+	  if (IsGraphStop(stop)) {
+		stops.push_back(&stop);
+	  }
+	}
+	if (stops.empty()) {
+	  return {};
+	}
+	const auto [lat_min, lat_max]
+		= std::minmax_element(stops.begin(), stops.end(), [](const Stop* lhs, const Stop* rhs) {
+			return lhs->geo.lat < rhs->geo.lat;
+		  });
+	const auto [lng_min, lng_max]
+		= std::minmax_element(stops.begin(), stops.end(), [](const Stop* lhs, const Stop* rhs) {
+			return lhs->geo.lng < rhs->geo.lng;
+		  });
+	constexpr int CURVE_ORDER = 16;
+	auto to_cell = [](double value, double min, double max) {
+	  const double cells = (uint32_t {1} << CURVE_ORDER) - 1.0;
+	  return max > min ? static_cast<uint32_t>((value - min) / (max - min) * cells) : 0;
+	};
+	std::vector<std::pair<uint64_t, std::string_view>> ordered;
+	ordered.reserve(stops.size());
+	for (const Stop* stop : stops) {
+	  ordered.emplace_back(
+		  GetHilbertIndex(to_cell(stop->geo.lng, (*lng_min)->geo.lng, (*lng_max)->geo.lng),
+						  to_cell(stop->geo.lat, (*lat_min)->geo.lat, (*lat_max)->geo.lat),
+						  CURVE_ORDER),
+		  stop->name);
+	}
+	std::sort(ordered.begin(), ordered.end());
+	std::vector<std::string_view> names;
+	names.reserve(ordered.size());
+	for (const auto& [index, name] : ordered) {
+	  names.push_back(name);
+	}
+	return names;
   }
 
+  /// With single_vertex_stops the IN and OUT vertices of a stop are the same.
+  /// The stops are numbered along the curve: the stops close in the city get
+  /// close vertices, so do their rows of the tables and their searches.
   void TransportRouter::AddStops() {
 	size_t vertex_count = 0;
-	for (auto [name, stop_ptr] : catalogue_.GetStopsForRender()) {
-	  Vertex in = {name, vertex_type::IN, vertex_count++};
-	  Vertex out = {name, vertex_type::OUT, vertex_count++};
+	for (const std::string_view name : GetGraphStopsAlongCurve()) {
+	  Vertex in = {name, vertex_type::IN, vertex_count};
+	  Vertex out = {name, vertex_type::OUT,
+					settings_.single_vertex_stops ? vertex_count : vertex_count + 1};
+	  vertex_count = out.id + 1;
 	  vertexes_[name] = {in, out};
 	}
-	graph_.ResizeIncidenceLists(vertexes_.size());
-	for (auto [name, data] : vertexes_) {
-	  graph_.AddEdge({data.in.id, data.out.id, settings_.bus_wait_time * 1.0});
-	  edges_.push_back({edge_type::WAIT, name, settings_.bus_wait_time * 1.0, 0});
+	graph_.ResizeIncidenceLists(vertex_count);
+	if (!settings_.single_vertex_stops) {
+	  for (auto [name, data] : vertexes_) {
+		graph_.AddEdge({data.in.id, data.out.id, settings_.bus_wait_time * 1.0});
+		edges_.push_back({edge_type::WAIT, name, settings_.bus_wait_time * 1.0, 0, 0, {}});
+	  }
+	}
+	IndexVertexStops();
+  }
+
+  void TransportRouter::AddStopVertexes(std::string_view name) {
+	if (vertexes_.count(name)) {
+	  return;
+	}
+	const size_t vertex_count = graph_.GetVertexCount();
+	Vertex in = {name, vertex_type::IN, vertex_count};
+	Vertex out = {name, vertex_type::OUT,
+				  settings_.single_vertex_stops ? vertex_count : vertex_count + 1};
+	vertexes_[name] = {in, out};
+	if (settings_.single_vertex_stops) {
+	  graph_.ResizeIncidenceLists(vertex_count + 1);
+	  return;
+	}
+	graph_.AddEdge({in.id, out.id, settings_.bus_wait_time * 1.0});
+	edges_.push_back({edge_type::WAIT, name, settings_.bus_wait_time * 1.0, 0, 0, {}});
+  }
+
+  void TransportRouter::IndexVertexStops() {
+	vertex_stops_.assign(graph_.GetVertexCount(), std::nullopt);
+	for (const auto& [name, data] : vertexes_) {
+	  vertex_stops_.at(data.in.id) = name;
+	}
+  }
+
+  std::vector<graph::EdgeId> TransportRouter::FreezeGraph() {
+	std::vector<graph::EdgeId> new_ids = graph_.Freeze();
+	std::vector<Edges> edges(edges_.size());
+	for (graph::EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+	  edges[new_ids[edge_id]] = edges_[edge_id];
 	}
+	edges_ = std::move(edges);
+	return new_ids;
   }
 
-  double TransportRouter::CalculateWeight(int distance) {
+  double TransportRouter::CalculateWeight(int distance) const {
 	return distance / (settings_.bus_velocity_kmh * 1000.0 / 60.0);
   }
 
+  double TransportRouter::GetRideWeight(const Edges& ride) const {
+	return settings_.single_vertex_stops ? settings_.bus_wait_time + ride.time : ride.time;
+  }
+
+  double TransportRouter::CalculateTime(const Edges& edge, const RouterSettings& settings) {
+	if (edge.type == edge_type::WAIT) {
+	  return settings.bus_wait_time * 1.0;
+	}
+	return edge.distance / (settings.bus_velocity_kmh * 1000.0 / 60.0);
+  }
+
+  /// The buses are collected in parallel, each into its own buffer, and
+  /// merged in the catalogue order, so the edge ids don't depend on the threads.
+  /// Buses riding between the same stops share one edge, the fastest ride, so
+  /// the searches relax every pair once; the first bus of the catalogue order
+  /// names it among as fast ones.
   void TransportRouter::AddEdges() {
-	for (auto [name, route_ptr] : catalogue_.GetRoutesForRender()) {
-	  for (auto it = route_ptr.stops.begin(); it != prev(route_ptr.stops.end()); ++it) {
-		int dist_to_next_stop = 0;
-		std::string_view out_stop = *it;
-		for (auto sub_it = it + 1; sub_it != route_ptr.stops.end(); ++sub_it) {
-		  if (!route_ptr.is_round_trip
-			  && sub_it - route_ptr.stops.begin() == ceil(route_ptr.stops.size() / 2) + 1
-			  && *prev(sub_it) == route_ptr.end_stop
-			  && it - route_ptr.stops.begin() != ceil(route_ptr.stops.size() / 2)) {
-			break;
-		  }
-		  if (catalogue_.GetDistForRouter().count(std::pair(out_stop, *sub_it))) {
-			dist_to_next_stop
-				+= catalogue_.GetDistForRouter().at(std::pair(out_stop, *sub_it));
-		  } else {
-			dist_to_next_stop
-				+= catalogue_.GetDistForRouter().at(std::pair(*sub_it, out_stop));
+	std::vector<const Bus*> buses;
+	buses.reserve(catalogue_.GetRoutesForRender().size());
+	for (const auto& [name, route] : catalogue_.GetRoutesForRender()) {
+	  buses.push_back(&route);
+	}
+	std::vector<BusEdges> bus_edges(buses.size());
+	std::vector<std::exception_ptr> errors(buses.size());
+	parallel::ForEachIndex(
+		buses.size(), parallel::ResolveThreadCount(std::max(settings_.threads, 0)),
+		[&](size_t i) {
+		  try {
+			bus_edges[i] = CollectBusEdges(*buses[i]);
+		  } catch (...) {
+			errors[i] = std::current_exception();
 		  }
-		  size_t span = sub_it - it;
-		  edges_.push_back(
-			  {edge_type::BUS, name, CalculateWeight(dist_to_next_stop), span});
-		  graph_.AddEdge({vertexes_.at(*it).out.id, vertexes_.at(*sub_it).in.id,
-						  edges_.back().time});
-		  out_stop = *sub_it;
+		});
+	BusEdges merged;
+	std::unordered_map<uint64_t, size_t> ride_indexes;
+	for (size_t i = 0; i < buses.size(); ++i) {
+	  if (errors[i]) {
+		std::rethrow_exception(errors[i]);
+	  }
+	  MergeBusEdges(bus_edges[i], merged, ride_indexes);
+	}
+	AppendBusEdges(merged);
+  }
+
+  /// distances[i] is the road from the i-th stop of the bus to the next one.
+  std::vector<int> TransportRouter::GetSegmentDistances(const Bus& bus) const {
+	const auto& distances = catalogue_.GetDistForRouter();
+	std::vector<int> segments;
+	segments.reserve(bus.stops.size());
+	for (size_t i = 1; i < bus.stops.size(); ++i) {
+	  const auto forward = distances.find(std::pair(bus.stops[i - 1], bus.stops[i]));
+	  segments.push_back(forward != distances.end()
+							 ? forward->second
+							 : distances.at(std::pair(bus.stops[i], bus.stops[i - 1])));
+	}
+	return segments;
+  }
+
+  /// Calls add_ride(from, to, distance, span_count) for every ride between two
+  /// stops of the bus, by the indices of the stops, in the order the edges are
+  /// added to the graph.
+  template <typename AddRide>
+  void TransportRouter::ForEachRide(const Bus& bus, AddRide add_ride) const {
+	const std::vector<int> segments = GetSegmentDistances(bus);
+	const size_t middle = bus.stops.size() / 2;
+	for (size_t from = 0; from + 1 < bus.stops.size(); ++from) {
+	  int distance = 0;
+	  for (size_t to = from + 1; to < bus.stops.size(); ++to) {
+		/// rides of a return trip don't go past the end stop
+		if (!bus.is_round_trip && to == middle + 1 && bus.stops[to - 1] == bus.end_stop
+			&& from != middle) {
+		  break;
+		}
+		distance += segments[to - 1];
+		add_ride(from, to, distance, to - from);
+	  }
+	}
+  }
+
+  /// The rides from and to the stops left out of the graph are their accesses.
+  TransportRouter::BusEdges TransportRouter::CollectBusEdges(const Bus& bus) const {
+	std::vector<const StopAsVertexes*> stop_vertexes;
+	stop_vertexes.reserve(bus.stops.size());
+	for (const std::string_view stop : bus.stops) {
+	  const auto it = vertexes_.find(stop);
+	  stop_vertexes.push_back(it != vertexes_.end() ? &it->second : nullptr);
+	}
+	BusEdges bus_edges;
+	ForEachRide(bus, [&](size_t from, size_t to, int distance, size_t span) {
+	  if (stop_vertexes[from] == nullptr || stop_vertexes[to] == nullptr) {
+		return;
+	  }
+	  bus_edges.edges.push_back(
+		  {edge_type::BUS, bus.name, CalculateWeight(distance), span, distance, {}});
+	  bus_edges.graph_edges.push_back({stop_vertexes[from]->out.id, stop_vertexes[to]->in.id,
+									   GetRideWeight(bus_edges.edges.back())});
+	});
+	return bus_edges;
+  }
+
+  uint64_t TransportRouter::GetRideKey(graph::VertexId from, graph::VertexId to) {
+	return static_cast<uint64_t>(from) << 32 | static_cast<uint64_t>(to);
+  }
+
+  void TransportRouter::MergeRide(Edges& kept, const Edges& ride) {
+	if (ride.time < kept.time) {
+	  kept = ride;
+	} else if (ride.time == kept.time && ride.name != kept.name
+			   && std::find(kept.other_buses.begin(), kept.other_buses.end(), ride.name)
+					  == kept.other_buses.end()) {
+	  kept.other_buses.push_back(ride.name);
+	}
+  }
+
+  void TransportRouter::MergeBusEdges(const BusEdges& bus_edges, BusEdges& merged,
+									  std::unordered_map<uint64_t, size_t>& ride_indexes) const {
+	for (size_t i = 0; i < bus_edges.edges.size(); ++i) {
+	  const graph::Edge<double>& edge = bus_edges.graph_edges[i];
+	  const auto [it, inserted]
+		  = ride_indexes.emplace(GetRideKey(edge.from, edge.to), merged.edges.size());
+	  if (inserted) {
+		merged.edges.push_back(bus_edges.edges[i]);
+		merged.graph_edges.push_back(edge);
+	  } else {
+		MergeRide(merged.edges[it->second], bus_edges.edges[i]);
+		merged.graph_edges[it->second].weight = GetRideWeight(merged.edges[it->second]);
+	  }
+	}
+  }
+
+  void TransportRouter::AppendBusEdges(const BusEdges& bus_edges) {
+	edges_.insert(edges_.end(), bus_edges.edges.begin(), bus_edges.edges.end());
+	for (const graph::Edge<double>& edge : bus_edges.graph_edges) {
+	  graph_.AddEdge(edge);
+	}
+  }
+
+  /// The graph is being built, the pairs that have an edge are taken from all
+  /// of its edges.
+  void TransportRouter::AddBusEdges(const Bus& bus) {
+	std::unordered_set<uint64_t> ride_keys;
+	for (const graph::Edge<double>& edge : graph_.ModifyEdges()) {
+	  ride_keys.insert(GetRideKey(edge.from, edge.to));
+	}
+	BusEdges merged;
+	std::unordered_map<uint64_t, size_t> ride_indexes;
+	MergeBusEdges(CollectBusEdges(bus), merged, ride_indexes);
+	BusEdges new_edges;
+	for (size_t i = 0; i < merged.edges.size(); ++i) {
+	  const graph::Edge<double>& edge = merged.graph_edges[i];
+	  if (!ride_keys.count(GetRideKey(edge.from, edge.to))) {
+		new_edges.edges.push_back(merged.edges[i]);
+		new_edges.graph_edges.push_back(edge);
+	  }
+	}
+	AppendBusEdges(new_edges);
+  }
+
+  /// The rides between the stops can only be of the buses passing the stops of
+  /// the given ones; they are merged in the catalogue order as in AddEdges.
+  void TransportRouter::UpdateRides(const std::vector<const Bus*>& buses,
+									std::vector<graph::EdgeId>& increased_edges,
+									std::vector<graph::EdgeId>& decreased_edges) {
+	std::unordered_set<uint64_t> ride_keys;
+	std::unordered_set<std::string_view> candidates;
+	for (const Bus* bus : buses) {
+	  for (const graph::Edge<double>& edge : CollectBusEdges(*bus).graph_edges) {
+		ride_keys.insert(GetRideKey(edge.from, edge.to));
+	  }
+	  for (const std::string_view stop : bus->stops) {
+		const std::set<std::string_view>& stop_buses = catalogue_.SearchStop(stop)->buses;
+		candidates.insert(stop_buses.begin(), stop_buses.end());
+	  }
+	}
+	std::unordered_map<uint64_t, Edges> fastest_rides;
+	for (const auto& [name, bus] : catalogue_.GetRoutesForRender()) {
+	  if (!candidates.count(name)) {
+		continue;
+	  }
+	  const BusEdges bus_edges = CollectBusEdges(bus);
+	  for (size_t i = 0; i < bus_edges.edges.size(); ++i) {
+		const graph::Edge<double>& edge = bus_edges.graph_edges[i];
+		const uint64_t key = GetRideKey(edge.from, edge.to);
+		if (!ride_keys.count(key)) {
+		  continue;
+		}
+		if (const auto [it, inserted] = fastest_rides.emplace(key, bus_edges.edges[i]);
+			!inserted) {
+		  MergeRide(it->second, bus_edges.edges[i]);
+		}
+	  }
+	}
+	const size_t increased_count = increased_edges.size();
+	const size_t decreased_count = decreased_edges.size();
+	for (const auto& [key, ride] : fastest_rides) {
+	  const graph::VertexId from = key >> 32;
+	  const graph::VertexId to = key & std::numeric_limits<uint32_t>::max();
+	  const auto edge_ids = graph_.GetIncidentEdges(from);
+	  const auto edge_id = std::find_if(edge_ids.begin(), edge_ids.end(), [&](graph::EdgeId id) {
+		return graph_.GetEdge(id).to == to && edges_[id].type == edge_type::BUS;
+	  });
+	  if (edge_id == edge_ids.end()) {
+		throw std::logic_error("Bus edges don't match the catalogue");
+	  }
+	  graph::Edge<double>& edge = graph_.ModifyEdges()[*edge_id];
+	  const double weight = GetRideWeight(ride);
+	  if (edge.weight < weight) {
+		increased_edges.push_back(*edge_id);
+	  } else if (weight < edge.weight) {
+		decreased_edges.push_back(*edge_id);
+	  }
+	  edge.weight = weight;
+	  edges_[*edge_id] = ride;
+	}
+	std::sort(increased_edges.begin() + increased_count, increased_edges.end());
+	std::sort(decreased_edges.begin() + decreased_count, decreased_edges.end());
+  }
+
+  void TransportRouter::AddStop(std::string_view name) {
+	const Stop* stop = catalogue_.SearchStop(name);
+	if (stop == nullptr) {
+	  throw std::invalid_argument("Unknown stop: "s + std::string(name));
+	}
+	if (settings_.engine == RouterEngine::RAPTOR) {
+	  CreateRouter();
+	  return;
+	}
+	if (!IsGraphStop(*stop)) {
+	  route_cache_.Clear();
+	  return;
+	}
+	const graph::EdgeId first_new_edge = graph_.GetEdgeCount();
+	graph_.Unfreeze();
+	AddStopVertexes(stop->name);
+	FreezeNewEdges(first_new_edge);
+  }
+
+  void TransportRouter::AddBus(std::string_view name) {
+	const Bus* bus = catalogue_.SearchRoute(name);
+	if (bus == nullptr) {
+	  throw std::invalid_argument("Unknown bus: "s + std::string(name));
+	}
+	if (settings_.engine == RouterEngine::RAPTOR) {
+	  CreateRouter();
+	  return;
+	}
+	const graph::EdgeId first_new_edge = graph_.GetEdgeCount();
+	graph_.Unfreeze();
+	/// a stop left out of the graph may join it, with the rides of its bus
+	std::vector<const Bus*> buses {bus};
+	for (const std::string_view stop : bus->stops) {
+	  const Stop& stop_data = *catalogue_.SearchStop(stop);
+	  if (vertexes_.count(stop) || !IsGraphStop(stop_data)) {
+		continue;
+	  }
+	  for (const std::string_view other : stop_data.buses) {
+		const Bus* other_bus = catalogue_.SearchRoute(other);
+		if (std::find(buses.begin(), buses.end(), other_bus) == buses.end()) {
+		  buses.push_back(other_bus);
+		}
+	  }
+	  AddStopVertexes(stop);
+	}
+	if (bus->stops.empty()) {
+	  FreezeNewEdges(first_new_edge);
+	  return;
+	}
+	for (const Bus* added : buses) {
+	  AddBusEdges(*added);
+	}
+	FreezeNewEdges(first_new_edge, buses);
+  }
+
+  void TransportRouter::UpdateDistance(std::string_view from, std::string_view to) {
+	const Stop* from_stop = catalogue_.SearchStop(from);
+	const Stop* to_stop = catalogue_.SearchStop(to);
+	if (from_stop == nullptr || to_stop == nullptr) {
+	  throw std::invalid_argument("Unknown stop: "s + std::string(from_stop ? to : from));
+	}
+	if (settings_.engine == RouterEngine::RAPTOR) {
+	  CreateRouter();
+	  return;
+	}
+	std::vector<const Bus*> buses;
+	for (const std::string_view bus : from_stop->buses) {
+	  if (to_stop->buses.count(bus)) {
+		buses.push_back(catalogue_.SearchRoute(bus));
+	  }
+	}
+	std::vector<graph::EdgeId> increased_edges;
+	std::vector<graph::EdgeId> decreased_edges;
+	UpdateRides(buses, increased_edges, decreased_edges);
+	RepairRouter({}, increased_edges, decreased_edges);
+  }
+
+  /// The rides of the buses between stops that had an edge already are merged
+  /// into it once the graph is frozen again.
+  void TransportRouter::FreezeNewEdges(graph::EdgeId first_new_edge,
+									   const std::vector<const Bus*>& buses) {
+	const std::vector<graph::EdgeId> new_ids = FreezeGraph();
+	IndexVertexStops();
+	FindComponents();
+	std::vector<graph::EdgeId> increased_edges;
+	std::vector<graph::EdgeId> decreased_edges;
+	UpdateRides(buses, increased_edges, decreased_edges);
+	for (graph::EdgeId edge_id = first_new_edge; edge_id < new_ids.size(); ++edge_id) {
+	  decreased_edges.push_back(new_ids[edge_id]);
+	}
+	RepairRouter(new_ids, increased_edges, decreased_edges);
+  }
+
+  void TransportRouter::RepairRouter(const std::vector<graph::EdgeId>& new_ids,
+									 const std::vector<graph::EdgeId>& increased_edges,
+									 const std::vector<graph::EdgeId>& decreased_edges) {
+	route_cache_.Clear();
+	if (UsesFixedPointWeights()) {
+	  BuildFixedPointGraph();
+	}
+	switch (settings_.engine) {
+	  case RouterEngine::FLOYD_WARSHALL:
+		if (UsesFixedPointWeights()) {
+		  RepairRoutesTable(*std::get<std::unique_ptr<graph::Router<FixedWeight>>>(router_),
+							new_ids, increased_edges, decreased_edges);
+		} else if (settings_.float_weights) {
+		  RepairRoutesTable(*std::get<std::unique_ptr<graph::Router<double, float>>>(router_),
+							new_ids, increased_edges, decreased_edges);
+		} else {
+		  RepairRoutesTable(*std::get<std::unique_ptr<graph::Router<double>>>(router_),
+							new_ids, increased_edges, decreased_edges);
 		}
+		break;
+	  case RouterEngine::DIJKSTRA:
+		break;
+	  case RouterEngine::A_STAR:
+		landmarks_.Update(graph_, parallel::ResolveThreadCount(std::max(settings_.threads, 0)));
+		EnableLowerBound();
+		break;
+	  case RouterEngine::PARTIAL: {
+		/// the promoted sources keep their trees
+		const std::vector<graph::VertexId> sources
+			= std::get<std::unique_ptr<graph::PartialRouter<double>>>(router_)->GetSources();
+		router_ = std::make_unique<graph::PartialRouter<double>>(
+			graph_, sources, std::max(settings_.promote_after, 0),
+			parallel::ResolveThreadCount(std::max(settings_.threads, 0)));
+		break;
 	  }
+	  case RouterEngine::OVERLAY:
+		if (new_ids.empty()) {
+		  /// the cells are the same, only the cliques of the reweighted edges change
+		  std::vector<graph::EdgeId> edges = increased_edges;
+		  edges.insert(edges.end(), decreased_edges.begin(), decreased_edges.end());
+		  std::get<std::unique_ptr<graph::MultiLevelOverlay<double>>>(router_)->UpdateEdges(
+			  edges);
+		} else {
+		  CreateRouter();
+		}
+		break;
+	  case RouterEngine::CONTRACTION_HIERARCHY:
+	  case RouterEngine::RAPTOR:
+	  case RouterEngine::HUB_LABELS:
+		CreateRouter();
+		break;
+	}
+  }
+
+  template <typename Router>
+  void TransportRouter::RepairRoutesTable(Router& router,
+										  const std::vector<graph::EdgeId>& new_ids,
+										  const std::vector<graph::EdgeId>& increased_edges,
+										  const std::vector<graph::EdgeId>& decreased_edges) {
+	router.AddVertices(graph_.GetVertexCount());
+	if (!new_ids.empty()) {
+	  router.RenumberEdges(new_ids);
 	}
+	router.UpdateEdges(increased_edges, decreased_edges);
   }
 }  // namespace transport_router
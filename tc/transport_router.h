@@ -1,20 +1,86 @@
 #pragma once
 
 #include <algorithm>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
 
+#include "cache.h"
+#include "components.h"
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
 #include "domain.h"
 #include "geo.h"
+#include "hub_labels.h"
+#include "landmarks.h"
+#include "multi_level_overlay.h"
+#include "partial_router.h"
+#include "raptor_router.h"
 #include "router.h"
 #include "svg.h"
 #include "transport_catalogue.h"
 
 namespace transport {
+  enum class RouterEngine {
+	FLOYD_WARSHALL,	 /// all-pairs table built at make_base
+	DIJKSTRA,		 /// graph only, search per query
+	CONTRACTION_HIERARCHY,	 /// shortcuts built at make_base, bidirectional search
+	RAPTOR,					 /// no graph, scans the bus lines per query
+	A_STAR,					 /// landmarks built at make_base, A* per query bounded by them
+	HUB_LABELS,				 /// 2-hop labels built at make_base, merge-join per query
+	PARTIAL,				 /// trees of the hot stops built at make_base, search for the rest
+	OVERLAY					 /// cell cliques built at make_base, search over the overlay
+  };
+
   struct RouterSettings {
 	int bus_wait_time = 6;		/// min
 	int bus_velocity_kmh = 40;	/// speed
+	RouterEngine engine = RouterEngine::FLOYD_WARSHALL;
+	bool float_weights = false;	 /// store the all-pairs table in float32
+	int threads = 0;			 /// make_base workers, 0 - all hardware threads
+	int route_cache_size = 4096;  /// routes kept for repeated Route requests, 0 - off
+	std::vector<std::string> hot_stops;	 /// partial engine: stops with a tree built at make_base
+	int promote_after = 0;	/// partial engine: searches from a stop before it gets a tree, 0 - never
+	int overlay_cell_size = 64;	 /// overlay engine: at most stops in a finest cell
+	int overlay_levels = 3;		 /// overlay engine: nested cell levels, 4 cells of a level per cell
+	int landmark_count = 8;		 /// a_star engine: ALT landmarks, 0 - straight lines only
+	bool fixed_point_weights = false;  /// floyd_warshall and dijkstra engines: integer weights
+	bool single_vertex_stops = false;  /// one vertex per stop, the wait is a part of every ride
+	bool compact_graph = false;	 /// no vertices for the stops without buses and pass-through stops
+	bool auto_engine = false;  /// make_base picks the fastest engine within the budgets
+	int memory_budget_mb = 0;  /// make_base: most estimated memory of the router, 0 - no limit
+	int build_time_budget_s = 0;  /// make_base: most estimated build time, 0 - no limit
+  };
+
+  /// Name of the engine in the routing settings.
+  std::string_view GetRouterEngineName(RouterEngine engine);
+
+  /// Size of the graph and the estimates of the engine over it, taken at
+  /// make_base before the engine is built.
+  struct RouterStatistics {
+	bool auto_engine = false;  /// the engine was picked by the budgets
+	size_t vertex_count = 0;
+	size_t edge_count = 0;
+	uint64_t memory_bytes = 0;
+	double build_seconds = 0.0;	  /// on one core, so it doesn't depend on the threads
+	double parallel_seconds = 0.0;  /// the part of build_seconds split between the threads, not saved
   };
+
+  /// Time of the fixed_point_weights setting in 1 / (50 * bus_velocity_kmh) min: a ride
+  /// of d meters is exactly 3 * d of them and a wait of whole minutes is exact too,
+  /// so the routes tie exactly where the times do.
+  using FixedWeight = uint32_t;
 }  // namespace transport
 
 namespace transport_router {
@@ -26,13 +92,22 @@ namespace transport_router {
         BUS
     };
 
+	/// With single_vertex_stops there are no WAIT edges, the graph weighs a ride
+	/// with the wait before it and the WAIT items of a route are added back.
     struct Edges {
 	  edge_type type;
 	  std::string_view name;
 	  double time;
 	  size_t span_count;
+	  int distance = 0;	 /// road meters of a bus ride, weighs it under other settings
+	  std::vector<std::string_view> other_buses;  /// ride between the same stops as fast
     };
 
+	struct RouteData {
+	  double weight;
+	  std::vector<Edges> items;
+	};
+
     enum class vertex_type {
         IN,
         OUT,
@@ -50,6 +125,37 @@ namespace transport_router {
 	  Vertex out;
 	};
 
+	using RouterVariant
+		= std::variant<std::unique_ptr<graph::Router<double>>,
+					   std::unique_ptr<graph::Router<double, float>>,
+					   std::unique_ptr<graph::Router<FixedWeight>>,
+					   std::unique_ptr<graph::DijkstraRouter<double>>,
+					   std::unique_ptr<graph::DijkstraRouter<FixedWeight>>,
+					   std::unique_ptr<graph::ContractionHierarchy<double>>,
+					   std::unique_ptr<RaptorRouter>,
+					   std::unique_ptr<graph::HubLabels<double>>,
+					   std::unique_ptr<graph::PartialRouter<double>>,
+					   std::unique_ptr<graph::MultiLevelOverlay<double>>>;
+
+	/// All-pairs router of the routes table with the stored weight: fixed-point
+	/// tables are searched over the fixed-point graph.
+	template <typename StoredWeight>
+	using TableRouter = std::conditional_t<std::is_integral_v<StoredWeight>,
+										   graph::Router<StoredWeight>,
+										   graph::Router<double, StoredWeight>>;
+
+	/// Ids of the stops of a route: IN vertices, or stop ids of the raptor engine.
+	using RouteKey = std::pair<size_t, size_t>;
+
+	struct RouteKeyHasher {
+	  size_t operator()(const RouteKey& key) const {
+		return std::hash<uint64_t> {}((static_cast<uint64_t>(key.first) << 32) ^ key.second);
+	  }
+	};
+
+	using RouteCache
+		= cache::ShardedLruCache<RouteKey, std::shared_ptr<const RouteData>, RouteKeyHasher>;
+
 	class TransportRouter {
 	public:
 	  TransportRouter(const TransportCatalogue& catalogue) : catalogue_(catalogue) {}
@@ -59,34 +165,246 @@ namespace transport_router {
 	  RouterSettings GetSettings() const;
 	  graph::DirectedWeightedGraph<double>& ModifyGraph();
 	  const graph::DirectedWeightedGraph<double>& GetGraph() const;
+	  /// The engine searches the fixed-point graph: fixed_point_weights is set and
+	  /// the engine is floyd_warshall or dijkstra, the others ignore it.
+	  bool UsesFixedPointWeights() const;
+	  /// Copies the graph with the times in FixedWeight units, edge ids are kept;
+	  /// call it after the graph is loaded. Throws std::length_error if a route
+	  /// might not fit.
+	  void BuildFixedPointGraph();
+	  /// Indexes the stops by their vertices; call it after the vertices are loaded.
+	  void IndexVertexStops();
+	  /// Components of the graph, for a base saved without them.
+	  void FindComponents();
 
+	  /// Throws std::length_error with the estimate if the engine is over the
+	  /// budgets of the settings, or no engine is within them for auto_engine.
 	  void GenerateRouter();
 	  void GenerateEmptyRouter();
-	  std::unique_ptr<graph::Router<double>>& ModifyRouter();
+	  const RouterVariant& GetRouterVariant() const;
+	  /// A* bound of the a_star engine: the larger of the landmark bound and the
+	  /// straight-line distance to the target over the bus velocity. The straight
+	  /// line is skipped if some road is shorter than it; returns false and leaves
+	  /// a plain Dijkstra search if there are no landmarks either.
+	  bool EnableLowerBound();
+
+	  /// Incremental updates: change the catalogue first, then tell the generated
+	  /// (or loaded) router. Only the affected edges of the graph are added or
+	  /// reweighted and the all-pairs table is repaired in place; the contraction
+	  /// hierarchy and the raptor lines are built again, the landmarks are searched
+	  /// from again. Cached routes are dropped.
+	  void AddStop(std::string_view name);
+	  /// The bus must be new to the router; its unknown stops are added too.
+	  void AddBus(std::string_view name);
+	  /// After SetDistBtwStops(from, to, ...): reweights the rides of the buses
+	  /// passing both stops.
+	  void UpdateDistance(std::string_view from, std::string_view to);
 
-	  using RouteData = graph::Router<double>::RouteInfo;
-	  std::optional<RouteData> GetRoute(std::string_view from, std::string_view to);
+	  /// nullptr when there is no route; stops the components show apart are
+	  /// answered without a search. Routes are cached until the router is
+	  /// generated again, unreachable pairs included; the routes of the stops
+	  /// left out of the graph are not.
+	  std::shared_ptr<const RouteData> GetRoute(std::string_view from, std::string_view to);
+	  /// Route under the wait time and velocity of the settings instead of the
+	  /// router's, the other settings are ignored. Unless they are the router's
+	  /// the graph is searched with the edges weighed at query time (the raptor
+	  /// lines are built for the query) and the route is not cached.
+	  std::shared_ptr<const RouteData> GetRoute(std::string_view from, std::string_view to,
+												const RouterSettings& settings);
+	  const RouteCache& GetRouteCache() const;
+	  /// Travel times from every source to every target, row-major by source,
+	  /// std::nullopt where there is no route.
+	  std::vector<std::optional<double>> GetTravelTimes(
+		  const std::vector<std::string_view>& sources,
+		  const std::vector<std::string_view>& targets);
+	  /// Stops reachable from the stop within max_time minutes and their travel
+	  /// times, ordered by time, the stop itself first.
+	  std::vector<std::pair<std::string_view, double>> GetReachableStops(
+		  std::string_view from, double max_time);
 
 	  std::vector<Edges>& ModifyEdgesData();
 	  const std::vector<Edges>* GetEdgesData() const;
 
 	  std::map<std::string_view, StopAsVertexes>& ModifyVertexes();
 	  const std::map<std::string_view, StopAsVertexes>* GetVertexes() const;
-	  const graph::Router<double>::RoutesInternalData& GetRouterData() const;
+	  template <typename StoredWeight>
+	  graph::RoutesTable<StoredWeight>& ModifyRouterData() {
+		return std::get<std::unique_ptr<TableRouter<StoredWeight>>>(router_)
+			->ModifyRoutesInternalData();
+	  }
+	  template <typename StoredWeight>
+	  const graph::RoutesTable<StoredWeight>& GetRouterData() const {
+		return std::get<std::unique_ptr<TableRouter<StoredWeight>>>(router_)
+			->GetRoutesInternalData();
+	  }
+	  std::unique_ptr<graph::ContractionHierarchy<double>>& ModifyContractionHierarchy();
+	  const graph::ContractionHierarchy<double>::HierarchyData& GetContractionHierarchyData()
+		  const;
+	  graph::HubLabels<double>::LabelData& ModifyHubLabelData();
+	  const graph::HubLabels<double>::LabelData& GetHubLabelData() const;
+	  graph::PartialRouter<double>& ModifyPartialRouter();
+	  const graph::PartialRouter<double>& GetPartialRouter() const;
+	  graph::MultiLevelOverlay<double>::OverlayData& ModifyOverlayData();
+	  const graph::MultiLevelOverlay<double>::OverlayData& GetOverlayData() const;
+	  graph::Landmarks<double>::LandmarkData& ModifyLandmarkData();
+	  const graph::Landmarks<double>::LandmarkData& GetLandmarkData() const;
+	  graph::Components::ComponentData& ModifyComponentData();
+	  const graph::Components::ComponentData& GetComponentData() const;
+	  RouterStatistics& ModifyStatistics();
+	  const RouterStatistics& GetStatistics() const;
 
 	private:
 	  RouterSettings settings_;
 	  const TransportCatalogue& catalogue_;
 
-	  std::unique_ptr<graph::Router<double>> router_ = nullptr;
+	  RouterVariant router_;
+	  RouteCache route_cache_;
+	  graph::Landmarks<double> landmarks_;
+	  graph::Components components_;
+	  RouterStatistics statistics_;
 
 	  graph::DirectedWeightedGraph<double> graph_;
+	  graph::DirectedWeightedGraph<FixedWeight> fixed_graph_;
 
 	  std::map<std::string_view, StopAsVertexes> vertexes_;
 	  std::vector<Edges> edges_;
+	  std::vector<geo::Coordinates> vertex_coordinates_;
+	  std::vector<std::optional<std::string_view>> vertex_stops_;  /// none for OUT vertices
 
+	  void CreateRouter();
+	  /// Memory and build time of the engine over the graph built, or over the
+	  /// catalogue for the raptor engine.
+	  RouterStatistics EstimateEngine(RouterEngine engine) const;
+	  double GetBuildTime(const RouterStatistics& statistics) const;
+	  bool IsWithinBudgets(const RouterStatistics& statistics) const;
+	  RouterEngine PickEngine() const;
+	  /// Throws std::length_error unless the estimate is within the budgets.
+	  void CheckBudgets(RouterEngine engine, const RouterStatistics& statistics) const;
+	  /// Unknown hot stops are skipped, a query log may be older than the base.
+	  std::vector<graph::VertexId> GetHotStopVertexes() const;
+	  /// Nested cells of the vertices by recursive halving of the stops along the
+	  /// longer side of their bounding box; both vertices of a stop share cells.
+	  graph::MultiLevelOverlay<double>::Partition PartitionVertexes() const;
+	  RouteKey GetRouteKey(std::string_view from, std::string_view to) const;
+	  /// FixedWeight units per minute.
+	  double GetFixedPointScale() const;
+	  template <typename Weight>
+	  double ToMinutes(Weight weight) const;
+	  /// The most weight within max_time minutes.
+	  template <typename Weight>
+	  Weight FromMinutes(double max_time) const;
+	  template <typename Router>
+	  std::optional<RouteData> BuildRoute(const Router& router, std::string_view from,
+										  std::string_view to) const;
+	  std::optional<RouteData> BuildRoute(const RaptorRouter& router, std::string_view from,
+										  std::string_view to) const;
+	  template <typename Router>
+	  std::vector<std::optional<double>> BuildWeights(
+		  const Router& router, const std::vector<std::string_view>& sources,
+		  const std::vector<std::string_view>& targets) const;
+	  std::vector<std::optional<double>> BuildWeights(
+		  const RaptorRouter& router, const std::vector<std::string_view>& sources,
+		  const std::vector<std::string_view>& targets) const;
+	  template <typename Router>
+	  std::vector<std::pair<std::string_view, double>> BuildWeightsWithin(
+		  const Router& router, std::string_view from, double max_time) const;
+	  template <typename Router>
+	  std::optional<RouteData> BuildVertexRoute(const Router& router, graph::VertexId from,
+												graph::VertexId to) const;
+	  /// compact_graph leaves out the stops served by no bus and the pass-through
+	  /// stops: served by one round-trip bus and once per trip, so nobody changes
+	  /// buses there and a route from (or to) one starts (ends) with a ride of the
+	  /// bus to (from) a stop of the graph. Those rides are the accesses of the
+	  /// stop; a stop of the graph has one, its IN vertex.
+	  struct StopAccess {
+		graph::VertexId vertex;
+		double time;
+		std::vector<Edges> items;
+	  };
+	  bool IsGraphStop(const Stop& stop) const;
+	  /// Accesses of the stop to the graph if from_stop, from the graph otherwise,
+	  /// timed under the wait time and velocity of the settings.
+	  std::vector<StopAccess> GetStopAccesses(std::string_view stop, bool from_stop,
+											  const RouterSettings& settings) const;
+	  /// Ride of the bus between two pass-through stops of it.
+	  std::optional<RouteData> GetDirectRide(std::string_view from, std::string_view to,
+											 const RouterSettings& settings) const;
+	  /// Times between all the sources and the targets with their accesses,
+	  /// row-major by source.
+	  template <typename Router>
+	  std::vector<std::optional<double>> BuildAccessTimes(
+		  const Router& router, const std::vector<StopAccess>& sources,
+		  const std::vector<StopAccess>& targets) const;
+	  template <typename Router>
+	  std::optional<RouteData> BuildCompactedRoute(const Router& router, std::string_view from,
+												   std::string_view to,
+												   const RouterSettings& settings) const;
+	  template <typename Router>
+	  std::vector<std::optional<double>> BuildCompactedWeights(
+		  const Router& router, const std::vector<std::string_view>& sources,
+		  const std::vector<std::string_view>& targets) const;
+	  std::vector<std::pair<std::string_view, double>> BuildWeightsWithin(
+		  const graph::ContractionHierarchy<double>& router, std::string_view from,
+		  double max_time) const;
+	  std::vector<std::pair<std::string_view, double>> BuildWeightsWithin(
+		  const graph::HubLabels<double>& router, std::string_view from, double max_time) const;
+	  std::vector<std::pair<std::string_view, double>> BuildWeightsWithin(
+		  const graph::MultiLevelOverlay<double>& router, std::string_view from,
+		  double max_time) const;
+	  /// For the engines without a one-to-all search.
+	  std::vector<std::pair<std::string_view, double>> SearchGraphWithin(
+		  std::string_view from, double max_time) const;
+	  std::vector<std::pair<std::string_view, double>> BuildWeightsWithin(
+		  const RaptorRouter& router, std::string_view from, double max_time) const;
+	  std::vector<std::pair<std::string_view, double>> GetStopsOfVertexes(
+		  const std::vector<std::pair<graph::VertexId, double>>& vertexes) const;
+	  /// Index of the cell on the Hilbert curve over a 2^order by 2^order grid.
+	  static uint64_t GetHilbertIndex(uint32_t x, uint32_t y, int order);
+	  /// Stops that get vertices, in the order of the Hilbert curve over their
+	  /// coordinates, by name within a cell.
+	  std::vector<std::string_view> GetGraphStopsAlongCurve() const;
 	  void AddStops();
-	  double CalculateWeight(int distance);
+	  void AddStopVertexes(std::string_view name);
+	  double CalculateWeight(int distance) const;
+	  /// Graph weight of a ride: its time, and the wait with single_vertex_stops.
+	  double GetRideWeight(const Edges& ride) const;
+	  /// Time of the edge under the wait time and velocity of the settings.
+	  static double CalculateTime(const Edges& edge, const RouterSettings& settings);
 	  void AddEdges();
+	  /// Edges of the rides of a bus, built apart from the graph.
+	  struct BusEdges {
+		std::vector<Edges> edges;
+		std::vector<graph::Edge<double>> graph_edges;
+	  };
+	  std::vector<int> GetSegmentDistances(const Bus& bus) const;
+	  template <typename AddRide>
+	  void ForEachRide(const Bus& bus, AddRide add_ride) const;
+	  BusEdges CollectBusEdges(const Bus& bus) const;
+	  static uint64_t GetRideKey(graph::VertexId from, graph::VertexId to);
+	  /// Keeps the faster ride in kept, a ride of another bus as fast is listed.
+	  static void MergeRide(Edges& kept, const Edges& ride);
+	  /// One edge per pair of vertices: ride_indexes maps the ride keys to merged.
+	  void MergeBusEdges(const BusEdges& bus_edges, BusEdges& merged,
+						 std::unordered_map<uint64_t, size_t>& ride_indexes) const;
+	  void AppendBusEdges(const BusEdges& bus_edges);
+	  /// Edges of the rides of the bus between stops that have none yet.
+	  void AddBusEdges(const Bus& bus);
+	  /// Takes the fastest ride of all buses again for every pair of stops the
+	  /// buses ride between; the edges must be there.
+	  void UpdateRides(const std::vector<const Bus*>& buses,
+					   std::vector<graph::EdgeId>& increased_edges,
+					   std::vector<graph::EdgeId>& decreased_edges);
+	  std::vector<graph::EdgeId> FreezeGraph();
+	  void FreezeNewEdges(graph::EdgeId first_new_edge,
+						  const std::vector<const Bus*>& buses = {});
+	  void RepairRouter(const std::vector<graph::EdgeId>& new_ids,
+						const std::vector<graph::EdgeId>& increased_edges,
+						const std::vector<graph::EdgeId>& decreased_edges);
+	  template <typename Router>
+	  void RepairRoutesTable(Router& router,
+							 const std::vector<graph::EdgeId>& new_ids,
+							 const std::vector<graph::EdgeId>& increased_edges,
+							 const std::vector<graph::EdgeId>& decreased_edges);
+	  bool RoadsAreNotShorterThanStraightLines() const;
 	};
 } // namespace map_renderer